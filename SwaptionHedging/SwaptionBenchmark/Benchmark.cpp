@@ -0,0 +1,219 @@
+#pragma warning (disable: 4819)
+#include <ql/qldefines.hpp>
+#ifdef BOOST_MSVC
+#  include <ql/auto_link.hpp>
+#endif
+#include <ql/quantlib.hpp>
+#include "../SwaptionHedging/CSVparser.hpp"
+#include "../SwaptionHedging/Market.hpp"
+#include "../SwaptionHedging/MarketData.hpp"
+#include "../SwaptionHedging/Portfolio.hpp"
+#include "../SwaptionHedging/CachedJamshidianSwaptionEngine.hpp"
+#include "../SwaptionHedging/Arena.hpp"
+#include "Benchmark.hpp"
+#include "EngineSweep.hpp"
+#include "SwaptionGrid.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace QuantLib;
+using namespace std;
+
+#if defined(QL_ENABLE_SESSIONS)
+namespace QuantLib {
+
+	Integer sessionId() { return 0; }
+
+}
+#endif
+
+/* Microbenchmarks of the building blocks of the pricing and hedging programs, all on the market data of one date.
+   Built with COUNT_ALLOCATIONS (set in this project) so that heap allocations per operation are reported too. */
+
+// the Monte Carlo loop of EuropeanSwaption_MC.cpp: one step to the expiry, annual fixed leg, fixed seed
+Real monteCarloSwaption(const HullWhite &model, const Handle<YieldTermStructure> &curve, const Date &today,
+	Integer maturity, Integer tenor, Rate strike, Size paths) {
+	Real x0 = 0.12550 / 100; // current short rate, as in EuropeanSwaption_MC.cpp
+	MersenneTwisterUniformRng unifMt(42);
+	BoxMullerGaussianRng<MersenneTwisterUniformRng> bmGauss(unifMt);
+	HullWhiteProcess process(curve, model.params()[0], model.params()[1]);
+	Time dt = maturity;
+	DiscountFactor discount = curve->discount(today + maturity * Years);
+	Real sum = 0.0;
+	for (Size j = 0; j < paths; j++) {
+		Real x = process.evolve(0.0, x0, dt, bmGauss.next().value);
+		Real annuity = 0.0;
+		for (Integer i = maturity + 1; i <= maturity + tenor; i++)
+			annuity += model.discountBond(dt, i, x);
+		Rate swapRate = (1.0 - model.discountBond(dt, maturity + tenor, x)) / annuity;
+		sum += discount * std::max(swapRate - strike, 0.0) * annuity;
+	}
+	return sum / paths;
+}
+
+// HullWhite's own starting point, every calibration starts from scratch
+void resetModel(HullWhite &model) {
+	Array initial(2);
+	initial[0] = 0.1;
+	initial[1] = 0.01;
+	model.setParams(initial);
+}
+
+// run the benchmark unless the filter is set and not part of its name
+template <class F>
+void run(vector<BenchmarkResult> &results, const string &filter, const string &name, double minSeconds, const F &f) {
+	if (!filter.empty() && name.find(filter) == string::npos)
+		return;
+	results.push_back(runBenchmark(name, f, minSeconds));
+	cout << name << ": " << results.back().nsPerOp << " ns/op" << endl;
+}
+
+// usage: SwaptionBenchmark [data directory] [output.json] [min seconds] [filter]
+//        SwaptionBenchmark --engines [data directory] [output.csv] [tolerance] [batch output.csv]
+int main(int argc, char *argv[]) {
+	if (argc > 1 && string(argv[1]) == "--engines")
+		return engineSweep(argc - 1, argv + 1);
+	string directory = (argc > 1) ? argv[1] : "..\\SwaptionHedging\\";
+	string outputFile = (argc > 2) ? argv[2] : "benchmark.json";
+	double minSeconds = (argc > 3) ? stod(argv[3]) : 0.5;
+	string filter = (argc > 4) ? argv[4] : "";
+	string dateString = "20080701";
+	string dfFile = directory + "DF_" + dateString + ".csv";
+	string ivFile = directory + "IV_" + dateString + ".csv";
+
+	GridMarket market = loadGridMarket(directory, dateString);
+	boost::shared_ptr<HullWhite> model(new HullWhite(market.curve));
+	boost::shared_ptr<PricingEngine> jamshidian(new JamshidianSwaptionEngine(model));
+	vector<boost::shared_ptr<CalibrationHelper> > surface = gridHelpers(market, false, jamshidian);
+	vector<boost::shared_ptr<CalibrationHelper> > diagonal = gridHelpers(market, true, jamshidian);
+	LevenbergMarquardt om;
+	EndCriteria endCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8);
+	model->calibrate(diagonal, om, endCriteria);
+	Array calibrated = model->params();
+	vector<GridSwaption> grid = atmGrid(market);
+	for (Size k = 0; k < grid.size(); k++)
+		grid[k].swaption->setPricingEngine(jamshidian);
+	const GridSwaption &fiveByFive = grid[4 * 10 + 4];
+	// the same grid on the engine that shares the expiry work between tenors
+	boost::shared_ptr<PricingEngine> cached(new CachedJamshidianSwaptionEngine(model));
+	vector<GridSwaption> cachedGrid = atmGrid(market);
+	Real largestDifference = 0.0;
+	for (Size k = 0; k < cachedGrid.size(); k++) {
+		cachedGrid[k].swaption->setPricingEngine(cached);
+		largestDifference = std::max(largestDifference,
+			std::fabs(cachedGrid[k].swaption->NPV() - grid[k].swaption->NPV()));
+	}
+	cout << "largest difference cached jamshidian - jamshidian on the grid: " << largestDifference << endl;
+
+	// the bitmap calendar against TARGET day by day, over the years the legs of the grid span
+	const BitmapCalendar &bitmap = targetCalendar();
+	Calendar target = TARGET();
+	BusinessDayConvention conventions[] = { Following, ModifiedFollowing, Preceding, ModifiedPreceding, Unadjusted };
+	Size calendarMismatches = 0;
+	for (Date d(1, January, 2000); d <= Date(31, December, 2060); d++) {
+		for (Size c = 0; c < 5; c++)
+			calendarMismatches += (bitmap.adjust(d, conventions[c]) != target.adjust(d, conventions[c]));
+		for (Integer n = -3; n <= 3; n++)
+			calendarMismatches += (bitmap.advance(d, n, Days) != target.advance(d, n, Days));
+		calendarMismatches += (bitmap.advance(d, 6, Months, ModifiedFollowing, true)
+			!= target.advance(d, 6, Months, ModifiedFollowing, true));
+	}
+	cout << "bitmap calendar dates different from TARGET: " << calendarMismatches << endl;
+
+	// the hedging program's curve on quotes, for the cost of a recalculation after one quote moved
+	Market quoted(market.today, market.dfs, market.vols);
+	Size bumps = 0;
+	// and one date of the backtest on it: the quotes, a recalibration from the default parameters and the portfolio
+	PortfolioPricer pricer(readPortfolio(directory + "Portfolio.csv"), quoted.termStructure(), quoted.index(),
+		quoted.model());
+	auto backtestDate = [&]() {
+		MarketTransaction update(quoted);
+		quoted.setMarket(market.today, market.dfs, market.vols);
+		update.commit(true);
+		return pricer.value().value;
+	};
+	Arena dateArena;
+
+	vector<BenchmarkResult> results;
+	run(results, filter, "parser DF file", minSeconds, [&]() { return double(Parser(dfFile).rowCount()); });
+	run(results, filter, "parser IV file", minSeconds, [&]() { return double(Parser(ivFile).rowCount()); });
+	run(results, filter, "DiscountFactorVec", minSeconds, [&]() { return DiscountFactorVec(dfFile).back(); });
+	run(results, filter, "ImpliedVolatilityVec", minSeconds, [&]() { return ImpliedVolatilityVec(ivFile).back(); });
+	// the legs of the 10x10 grid without the schedule cache, on each calendar through the Calendar interface
+	// a Schedule uses
+	auto gridSchedules = [&](const Calendar &calendar) {
+		Size dates = 0;
+		for (Integer i = 1; i <= 10; i++)
+			for (Integer j = 1; j <= 10; j++) {
+				Date start = calendar.advance(market.today, i, Years, ModifiedFollowing);
+				Date end = calendar.advance(start, j, Years, ModifiedFollowing);
+				dates += Schedule(start, end, Period(Quarterly), calendar, ModifiedFollowing, ModifiedFollowing,
+					DateGeneration::Forward, false).size();
+			}
+		return double(dates);
+	};
+	run(results, filter, "schedules 10x10 TARGET", minSeconds, [&]() { return gridSchedules(target); });
+	run(results, filter, "schedules 10x10 bitmap calendar", minSeconds, [&]() { return gridSchedules(bitmap); });
+	run(results, filter, "curve build", minSeconds, [&]() {
+		return buildCurve(market.today, market.dfs)->discount(1.0);
+	});
+	run(results, filter, "quoted curve recalculation", minSeconds, [&]() {
+		bumps++;
+		quoted.setDiscountFactor(12, market.dfs[12] * (bumps % 2 ? 1.000001 : 1.0));
+		return quoted.termStructure()->discount(1.0);
+	});
+	run(results, filter, "backtest date heap", minSeconds, backtestDate);
+	run(results, filter, "backtest date arena", minSeconds, [&]() { // allocs/op are those left on the heap
+		Real value;
+		{
+			ArenaScope scope(dateArena);
+			value = backtestDate();
+		}
+		dateArena.release();
+		return value;
+	});
+	run(results, filter, "calibration diagonal", minSeconds, [&]() {
+		resetModel(*model);
+		model->calibrate(diagonal, om, endCriteria);
+		return model->params()[1];
+	});
+	run(results, filter, "calibration 10x10", minSeconds, [&]() {
+		resetModel(*model);
+		model->calibrate(surface, om, endCriteria);
+		return model->params()[1];
+	});
+	run(results, filter, "jamshidian grid", minSeconds, [&]() {
+		model->setParams(calibrated); // notifies, so every swaption is priced again
+		Real sum = 0.0;
+		for (Size k = 0; k < grid.size(); k++)
+			sum += grid[k].swaption->NPV();
+		return sum;
+	});
+	run(results, filter, "cached jamshidian grid", minSeconds, [&]() {
+		model->setParams(calibrated);
+		Real sum = 0.0;
+		for (Size k = 0; k < cachedGrid.size(); k++)
+			sum += cachedGrid[k].swaption->NPV();
+		return sum;
+	});
+	Size paths[] = { 1000, 10000, 100000 };
+	for (Size p = 0; p < 3; p++)
+		run(results, filter, "monte carlo 5x5 " + to_string(paths[p]) + " paths", minSeconds, [&]() {
+			return monteCarloSwaption(*model, market.curve, market.today, 5, 5, fiveByFive.strike, paths[p]);
+		});
+	model->setParams(calibrated);
+	Real npv = fiveByFive.swaption->NPV();
+	run(results, filter, "implied volatility 5x5", minSeconds, [&]() {
+		return fiveByFive.swaption->impliedVolatility(npv, market.curve, 0.05);
+	});
+
+	cout << endl;
+	writeBenchmarkTable(cout, results);
+	ofstream oFile;
+	oFile.open(outputFile.c_str(), ios::out | ios::trunc);
+	writeBenchmarkJson(oFile, dateString, minSeconds, results);
+	oFile.close();
+	return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef     _BENCHMARK_HPP_
+# define    _BENCHMARK_HPP_
+
+#include "../SwaptionHedging/AllocationCounter.hpp"
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// This file runs one benchmark: the operation is repeated in doubling batches until a batch takes at
+// least the minimum time, the last batch gives time and heap allocations per operation. //
+
+struct BenchmarkResult {
+	std::string name;
+	std::size_t iterations;
+	double nsPerOp;
+	double allocationsPerOp; // 0 unless built with COUNT_ALLOCATIONS
+	double bytesPerOp;
+};
+
+// f returns a number computed from its result, so that the work cannot be optimized away
+template <class F>
+BenchmarkResult runBenchmark(const std::string &name, const F &f, double minSeconds) {
+	volatile double sink = f(); // warm up, also builds anything cached on first use
+	std::size_t n = 1;
+	for (;;) {
+		AllocationCount before = allocationCount();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < n; i++)
+			sink = sink + f();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		AllocationCount after = allocationCount();
+		if (seconds >= minSeconds || n >= (std::size_t(1) << 30)) {
+			BenchmarkResult r = { name, n, seconds * 1.0e9 / n,
+				double(after.allocations - before.allocations) / n, double(after.bytes - before.bytes) / n };
+			return r;
+		}
+		n *= 2;
+	}
+}
+
+inline void writeBenchmarkTable(std::ostream &out, const std::vector<BenchmarkResult> &results) {
+	for (std::size_t k = 0; k < results.size(); k++)
+		out << results[k].name << ": " << results[k].nsPerOp << " ns/op, " << results[k].allocationsPerOp
+			<< " allocs/op, " << results[k].bytesPerOp << " bytes/op (" << results[k].iterations << " ops)" << std::endl;
+}
+
+inline void writeBenchmarkJson(std::ostream &out, const std::string &date, double minSeconds,
+	const std::vector<BenchmarkResult> &results) {
+	out << "{" << std::endl;
+	out << "  \"date\": \"" << date << "\"," << std::endl;
+	out << "  \"minSeconds\": " << minSeconds << "," << std::endl;
+	out << "  \"allocationCounting\": " << (allocationCounting() ? "true" : "false") << "," << std::endl;
+	out << "  \"benchmarks\": [" << std::endl;
+	for (std::size_t k = 0; k < results.size(); k++) {
+		const BenchmarkResult &r = results[k];
+		out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+			<< ", \"nsPerOp\": " << r.nsPerOp << ", \"allocationsPerOp\": " << r.allocationsPerOp
+			<< ", \"bytesPerOp\": " << r.bytesPerOp << "}" << (k + 1 < results.size() ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl << "}" << std::endl;
+}
+
+#endif /*!_BENCHMARK_HPP_*/
@@ -0,0 +1,382 @@
+#include <ql/quantlib.hpp>
+#include "EngineSweep.hpp"
+#include "SwaptionGrid.hpp"
+#include "../SwaptionHedging/FastG2SwaptionEngine.hpp"
+#include "../SwaptionHedging/CachedJamshidianSwaptionEngine.hpp"
+#include "../SwaptionHedging/HullWhiteLattice.hpp"
+#include "../SwaptionHedging/BatchedFdHullWhite.hpp"
+#include "../SwaptionHedging/ParallelFor.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace QuantLib;
+using namespace std;
+
+struct EngineSetting {
+	string model; // settings are only compared with others of the same model
+	string engine;
+	string setting;
+	Real maxError; // largest relative price error over the grid
+	Real rmsError;
+	double millis; // pricing the whole grid
+	bool pareto;
+};
+
+// Monte Carlo in the forward measure of the expiry T: r(T) is normal and the swaption pays the value
+// of the underlying swap at T, from the model's bond prices
+Real monteCarloValue(const HullWhite &model, const Handle<YieldTermStructure> &curve,
+	const Swaption &swaption, Size paths) {
+	Real a = model.a(), sigma = model.sigma();
+	Date expiryDate = swaption.exercise()->lastDate();
+	Time T = curve->timeFromReference(expiryDate);
+	const Leg &fixedLeg = swaption.underlyingSwap()->fixedLeg();
+	vector<Time> payTimes;
+	vector<Real> coupons;
+	for (Size i = 0; i < fixedLeg.size(); i++) {
+		payTimes.push_back(curve->timeFromReference(fixedLeg[i]->date()));
+		coupons.push_back(fixedLeg[i]->amount());
+	}
+	coupons.back() += 1.0; // unit notional
+
+	Real v2 = sigma * sigma * (1.0 - std::exp(-2.0 * a * T)) / (2.0 * a);
+	Real temp = sigma * (1.0 - std::exp(-a * T)) / a;
+	Rate forward = curve->forwardRate(T, T, Continuous, NoFrequency, true);
+	Real alpha = forward + 0.5 * temp * temp;
+	// the change to the T-forward measure moves the mean of x(T) down by M(0,T) (Brigo-Mercurio 3.39)
+	Real mean = alpha - sigma * sigma / (a * a) * (1.0 - std::exp(-a * T))
+		+ 0.5 * sigma * sigma / (a * a) * (1.0 - std::exp(-2.0 * a * T));
+	Real sign = (swaption.type() == VanillaSwap::Payer) ? 1.0 : -1.0;
+
+	MersenneTwisterUniformRng unifMt(42);
+	BoxMullerGaussianRng<MersenneTwisterUniformRng> bmGauss(unifMt);
+	Real sum = 0.0;
+	for (Size j = 0; j < paths; j++) {
+		Rate r = mean + std::sqrt(v2) * bmGauss.next().value;
+		Real swap = 1.0; // the bond paying at the swap start, which is the expiry
+		for (Size i = 0; i < payTimes.size(); i++)
+			swap -= coupons[i] * model.discountBond(T, payTimes[i], r);
+		sum += std::max(sign * swap, 0.0);
+	}
+	return curve->discount(T) * sum / paths;
+}
+
+// the swaption for the shared lattice, its times from the curve's reference date
+LatticeSwaption latticeSwaption(const Swaption &swaption, const Handle<YieldTermStructure> &curve) {
+	LatticeSwaption s;
+	s.payer = (swaption.type() == VanillaSwap::Payer);
+	const vector<Date> &exerciseDates = swaption.exercise()->dates();
+	for (Size k = 0; k < exerciseDates.size(); k++)
+		s.exerciseTimes.push_back(curve->timeFromReference(exerciseDates[k]));
+	const Leg &fixedLeg = swaption.underlyingSwap()->fixedLeg();
+	for (Size i = 0; i < fixedLeg.size(); i++) {
+		s.payTimes.push_back(curve->timeFromReference(fixedLeg[i]->date()));
+		s.coupons.push_back(fixedLeg[i]->amount());
+	}
+	s.coupons.back() += 1.0; // unit notional
+	return s;
+}
+
+// the whole grid on one tree of the model, built from the curve on the grid's own times
+vector<Real> sharedLatticeValues(const HullWhite &model, const Handle<YieldTermStructure> &curve,
+	const vector<GridSwaption> &grid, Size steps) {
+	vector<LatticeSwaption> swaptions;
+	for (Size k = 0; k < grid.size(); k++)
+		swaptions.push_back(latticeSwaption(*grid[k].swaption, curve));
+	Time last = 0.0;
+	for (Size k = 0; k < swaptions.size(); k++)
+		last = std::max(last, swaptions[k].payTimes.back());
+	vector<Time> times = latticeTimeGrid(swaptions, last / steps);
+	vector<DiscountFactor> discounts;
+	for (Size i = 0; i < times.size(); i++)
+		discounts.push_back(curve->discount(times[i]));
+	HullWhiteLattice lattice(model.a(), model.sigma(), times, discounts);
+	return lattice.price(swaptions);
+}
+
+// the swaption for the batched finite difference grid, with the model's bond coefficients seen from its exercise
+// times
+HullWhiteFdSwaption fdSwaption(const HullWhite &model, const Swaption &swaption, const Handle<YieldTermStructure> &curve) {
+	LatticeSwaption s = latticeSwaption(swaption, curve);
+	HullWhiteFdSwaption fd;
+	fd.swaption.a = model.a();
+	fd.swaption.sigma = model.sigma();
+	fd.swaption.payer = s.payer;
+	fd.swaption.payTimes = s.payTimes;
+	fd.swaption.coupons = s.coupons;
+	for (Size k = 0; k < s.exerciseTimes.size(); k++) {
+		Time t = s.exerciseTimes[k];
+		Size first = std::upper_bound(s.payTimes.begin(), s.payTimes.end(), t) - s.payTimes.begin();
+		fd.swaption.exerciseTimes.push_back(t);
+		fd.swaption.firstCoupon.push_back(first);
+		BondCoefficients c;
+		c.t = t;
+		vector<Time> maturities(1, t);
+		maturities.insert(maturities.end(), s.payTimes.begin() + first, s.payTimes.end());
+		for (Size i = 0; i < maturities.size(); i++) {
+			Real A = model.discountBond(t, maturities[i], 0.0);
+			c.A.push_back(A);
+			c.B.push_back(-std::log(model.discountBond(t, maturities[i], 1.0) / A));
+		}
+		fd.coeffs.push_back(c);
+	}
+	return fd;
+}
+
+// one finite difference grid of points x points steps up to the last expiry of the swaptions, 16 per block
+HullWhiteFdSetup fdSetup(const HullWhite &model, const Handle<YieldTermStructure> &curve,
+	const vector<HullWhiteFdSwaption> &swaptions, Size points) {
+	Time last = 0.0;
+	for (Size k = 0; k < swaptions.size(); k++)
+		last = std::max(last, swaptions[k].swaption.exerciseTimes.back());
+	HullWhiteFdSetup setup;
+	setup.a = model.a();
+	setup.sigma = model.sigma();
+	setup.times = hullWhiteFdTimeGrid(swaptions, last / points);
+	for (Size i = 0; i < setup.times.size(); i++) {
+		Time t = setup.times[i];
+		Real temp = setup.sigma * (1.0 - std::exp(-setup.a * t)) / setup.a;
+		setup.alpha.push_back(curve->forwardRate(t, t, Continuous, NoFrequency, true) + 0.5 * temp * temp);
+	}
+	setup.xPoints = points | 1;
+	setup.xStdDevs = 5.0;
+	setup.dampingSteps = 2;
+	setup.lanes = 16;
+	setup.threads = defaultThreadCount();
+	return setup;
+}
+
+// the whole grid on one finite difference grid
+vector<Real> batchedFdValues(const HullWhite &model, const Handle<YieldTermStructure> &curve,
+	const vector<GridSwaption> &grid, Size points) {
+	vector<HullWhiteFdSwaption> swaptions;
+	for (Size k = 0; k < grid.size(); k++)
+		swaptions.push_back(fdSwaption(model, *grid[k].swaption, curve));
+	return priceHullWhiteFd(fdSetup(model, curve, swaptions, points), swaptions);
+}
+
+// the best of a few runs, in microseconds
+template <class F>
+double bestMicros(F f) {
+	double best = 0.0;
+	for (Size r = 0; r < 5; r++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		f();
+		double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+		best = (r == 0) ? micros : std::min(best, micros);
+	}
+	return best;
+}
+
+struct BatchTiming {
+	string engine;
+	Size batch; // swaptions priced together
+	Size swaptions;
+	double micros;
+};
+
+// time per swaption against the number of swaptions sharing a sweep, on one thread: the first n swaptions of
+// the grid on one lattice of 100 steps built for the whole grid, and the whole grid on a 100 x 100 finite
+// difference grid in blocks of n lanes
+vector<BatchTiming> batchTimings(const HullWhite &model, const Handle<YieldTermStructure> &curve,
+	const vector<GridSwaption> &grid) {
+	vector<BatchTiming> timings;
+	vector<LatticeSwaption> lattice;
+	for (Size k = 0; k < grid.size(); k++)
+		lattice.push_back(latticeSwaption(*grid[k].swaption, curve));
+	Time last = 0.0;
+	for (Size k = 0; k < lattice.size(); k++)
+		last = std::max(last, lattice[k].payTimes.back());
+	vector<Time> times = latticeTimeGrid(lattice, last / 100);
+	vector<DiscountFactor> discounts;
+	for (Size i = 0; i < times.size(); i++)
+		discounts.push_back(curve->discount(times[i]));
+	HullWhiteLattice tree(model.a(), model.sigma(), times, discounts);
+	Size batches[] = { 1, 2, 4, 8, 16, 32, 100 };
+	for (Size i = 0; i < 7; i++) {
+		vector<LatticeSwaption> swaptions(lattice.begin(), lattice.begin() + std::min(batches[i], lattice.size()));
+		BatchTiming t = { "Shared lattice", swaptions.size(), swaptions.size(),
+			bestMicros([&]() { tree.price(swaptions); }) };
+		timings.push_back(t);
+	}
+
+	vector<HullWhiteFdSwaption> fd;
+	for (Size k = 0; k < grid.size(); k++)
+		fd.push_back(fdSwaption(model, *grid[k].swaption, curve));
+	HullWhiteFdSetup setup = fdSetup(model, curve, fd, 100);
+	setup.threads = 1;
+	for (Size i = 0; i < 7; i++) {
+		setup.lanes = batches[i];
+		BatchTiming t = { "Batched FD", batches[i], fd.size(), bestMicros([&]() { priceHullWhiteFd(setup, fd); }) };
+		timings.push_back(t);
+	}
+	for (Size i = 0; i < timings.size(); i++)
+		cout << timings[i].engine << ", " << timings[i].batch << " per sweep: "
+			<< timings[i].micros / timings[i].swaptions << " us per swaption" << endl;
+	return timings;
+}
+
+// relative errors of the grid prices against the reference prices
+EngineSetting gradeSetting(const string &model, const string &engine, const string &setting,
+	const vector<Real> &prices, const vector<Real> &reference, double millis) {
+	EngineSetting s = { model, engine, setting, 0.0, 0.0, millis, false };
+	for (Size k = 0; k < prices.size(); k++) {
+		Real e = std::fabs(prices[k] / reference[k] - 1.0);
+		s.maxError = std::max(s.maxError, e);
+		s.rmsError += e * e;
+	}
+	s.rmsError = std::sqrt(s.rmsError / prices.size());
+	cout << model << " " << engine << " " << setting << ": max error " << s.maxError << ", " << millis << " ms" << endl;
+	return s;
+}
+
+// price the grid with the engine and compare with the reference prices
+EngineSetting sweepEngine(const string &model, const string &engine, const string &setting,
+	const vector<GridSwaption> &grid, const boost::shared_ptr<PricingEngine> &pricingEngine,
+	const vector<Real> &reference) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<Real> prices;
+	for (Size k = 0; k < grid.size(); k++) {
+		grid[k].swaption->setPricingEngine(pricingEngine);
+		prices.push_back(grid[k].swaption->NPV());
+	}
+	double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	return gradeSetting(model, engine, setting, prices, reference, millis);
+}
+
+int engineSweep(int argc, char *argv[]) {
+	string directory = (argc > 1) ? argv[1] : "..\\SwaptionHedging\\";
+	string outputFile = (argc > 2) ? argv[2] : "engine_pareto.csv";
+	Real tolerance = (argc > 3) ? stod(argv[3]) : 1.0e-3;
+	string batchFile = (argc > 4) ? argv[4] : "engine_batch.csv";
+
+	GridMarket market = loadGridMarket(directory, "20080701");
+	vector<GridSwaption> grid = atmGrid(market);
+	LevenbergMarquardt om;
+	EndCriteria endCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8);
+	vector<EngineSetting> settings;
+
+	// Hull-White: Jamshidian is exact, everything else is compared with it
+	boost::shared_ptr<HullWhite> hullWhite(new HullWhite(market.curve));
+	boost::shared_ptr<PricingEngine> jamshidian(new JamshidianSwaptionEngine(hullWhite));
+	hullWhite->calibrate(gridHelpers(market, true, jamshidian), om, endCriteria);
+	vector<Real> hwReference;
+	for (Size k = 0; k < grid.size(); k++) {
+		grid[k].swaption->setPricingEngine(jamshidian);
+		hwReference.push_back(grid[k].swaption->NPV());
+	}
+	settings.push_back(sweepEngine("Hull-White", "Jamshidian", "analytic", grid, jamshidian, hwReference));
+	settings.push_back(sweepEngine("Hull-White", "Cached Jamshidian", "analytic", grid,
+		boost::shared_ptr<PricingEngine>(new CachedJamshidianSwaptionEngine(hullWhite)), hwReference));
+	Size treeSteps[] = { 25, 50, 100, 200, 400 };
+	for (Size i = 0; i < 5; i++)
+		settings.push_back(sweepEngine("Hull-White", "Tree", to_string(treeSteps[i]) + " steps", grid,
+			boost::shared_ptr<PricingEngine>(new TreeSwaptionEngine(hullWhite, treeSteps[i])), hwReference));
+	// the same steps over the longest swaption instead of each one, and one tree for the grid
+	for (Size i = 0; i < 5; i++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<Real> prices = sharedLatticeValues(*hullWhite, market.curve, grid, treeSteps[i]);
+		double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		settings.push_back(gradeSetting("Hull-White", "Shared lattice", to_string(treeSteps[i]) + " steps",
+			prices, hwReference, millis));
+	}
+	Size fdGrids[] = { 25, 50, 100, 200, 400 };
+	for (Size i = 0; i < 5; i++)
+		settings.push_back(sweepEngine("Hull-White", "FD", to_string(fdGrids[i]) + "x" + to_string(fdGrids[i]), grid,
+			boost::shared_ptr<PricingEngine>(new FdHullWhiteSwaptionEngine(hullWhite, fdGrids[i], fdGrids[i])), hwReference));
+	// the same grids over the last expiry instead of each swaption, and one grid for all of them
+	for (Size i = 0; i < 5; i++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<Real> prices = batchedFdValues(*hullWhite, market.curve, grid, fdGrids[i]);
+		double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		settings.push_back(gradeSetting("Hull-White", "Batched FD", to_string(fdGrids[i]) + "x" + to_string(fdGrids[i]),
+			prices, hwReference, millis));
+	}
+	vector<BatchTiming> timings = batchTimings(*hullWhite, market.curve, grid);
+	Size paths[] = { 1000, 10000, 100000 };
+	for (Size i = 0; i < 3; i++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		vector<Real> prices;
+		for (Size k = 0; k < grid.size(); k++)
+			prices.push_back(monteCarloValue(*hullWhite, market.curve, *grid[k].swaption, paths[i]));
+		double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		settings.push_back(gradeSetting("Hull-White", "Monte Carlo", to_string(paths[i]) + " paths",
+			prices, hwReference, millis));
+	}
+
+	// G2++: no closed form, the reference is the integration engine on a fine grid
+	boost::shared_ptr<G2> g2(new G2(market.curve));
+	g2->calibrate(gridHelpers(market, true, boost::shared_ptr<PricingEngine>(new G2SwaptionEngine(g2, 6.0, 16))),
+		om, endCriteria);
+	boost::shared_ptr<PricingEngine> g2Reference(new G2SwaptionEngine(g2, 10.0, 1000));
+	vector<Real> g2Prices;
+	for (Size k = 0; k < grid.size(); k++) {
+		grid[k].swaption->setPricingEngine(g2Reference);
+		g2Prices.push_back(grid[k].swaption->NPV());
+	}
+	Size intervals[] = { 4, 8, 16, 32, 64, 128 };
+	for (Size i = 0; i < 6; i++)
+		settings.push_back(sweepEngine("G2++", "Integration", "range 6, " + to_string(intervals[i]) + " intervals", grid,
+			boost::shared_ptr<PricingEngine>(new G2SwaptionEngine(g2, 6.0, intervals[i])), g2Prices));
+	Size nodes[] = { 8, 16, 32, 64 };
+	for (Size i = 0; i < 4; i++)
+		settings.push_back(sweepEngine("G2++", "Gauss-Hermite", to_string(nodes[i]) + " nodes", grid,
+			boost::shared_ptr<PricingEngine>(new FastG2SwaptionEngine(g2, nodes[i])), g2Prices));
+	Size fdG2Grids[] = { 10, 20, 40 };
+	for (Size i = 0; i < 3; i++) {
+		Size n = fdG2Grids[i];
+		settings.push_back(sweepEngine("G2++", "FD", to_string(n) + "x" + to_string(n) + "x" + to_string(n), grid,
+			boost::shared_ptr<PricingEngine>(new FdG2SwaptionEngine(g2, n, n, n)), g2Prices));
+	}
+
+	// Pareto front per model: nothing of the same model is both more accurate and faster
+	for (Size i = 0; i < settings.size(); i++) {
+		settings[i].pareto = true;
+		for (Size j = 0; j < settings.size(); j++)
+			if (j != i && settings[j].model == settings[i].model
+				&& settings[j].maxError <= settings[i].maxError && settings[j].millis <= settings[i].millis
+				&& (settings[j].maxError < settings[i].maxError || settings[j].millis < settings[i].millis))
+				settings[i].pareto = false;
+	}
+
+	ofstream oFile;
+	oFile.open(outputFile.c_str(), ios::out | ios::trunc);
+	oFile << "Model" << "," << "Engine" << "," << "Setting" << "," << "Max Rel Error" << "," << "RMS Rel Error" << ","
+		<< "Grid Time (ms)" << "," << "Pareto" << endl;
+	for (Size i = 0; i < settings.size(); i++)
+		oFile << settings[i].model << "," << settings[i].engine << "," << settings[i].setting << ","
+			<< settings[i].maxError << "," << settings[i].rmsError << "," << settings[i].millis << ","
+			<< (settings[i].pareto ? "yes" : "no") << endl;
+	oFile.close();
+	oFile.open(batchFile.c_str(), ios::out | ios::trunc);
+	oFile << "Engine" << "," << "Batch" << "," << "Swaptions" << "," << "Time (us)" << "," << "Time per Swaption (us)" << endl;
+	for (Size i = 0; i < timings.size(); i++)
+		oFile << timings[i].engine << "," << timings[i].batch << "," << timings[i].swaptions << "," << timings[i].micros
+			<< "," << timings[i].micros / timings[i].swaptions << endl;
+	oFile.close();
+
+	// the cheapest setting of every model that meets the tolerance
+	cout << endl << "Pareto front:" << endl;
+	string models[] = { "Hull-White", "G2++" };
+	for (Size m = 0; m < 2; m++) {
+		const EngineSetting *cheapest = 0;
+		for (Size i = 0; i < settings.size(); i++) {
+			const EngineSetting &s = settings[i];
+			if (s.model != models[m])
+				continue;
+			if (s.pareto)
+				cout << s.model << " " << s.engine << " " << s.setting << ": max error " << s.maxError
+					<< ", " << s.millis << " ms" << endl;
+			if (s.maxError <= tolerance && (!cheapest || s.millis < cheapest->millis))
+				cheapest = &s;
+		}
+		if (cheapest)
+			cout << "cheapest " << models[m] << " engine within " << tolerance << ": " << cheapest->engine << " "
+				<< cheapest->setting << " (" << cheapest->millis << " ms)" << endl;
+		else
+			cout << "no " << models[m] << " engine within " << tolerance << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef     _ENGINESWEEP_HPP_
+# define    _ENGINESWEEP_HPP_
+
+// This file and EngineSweep.cpp price the 10x10 ATM grid with every swaption engine over a range of
+// resolutions and report accuracy against a reference next to the time spent, as a Pareto table. The shared
+// lattice and the batched finite differences are also timed against the number of swaptions per sweep. //
+
+// usage: SwaptionBenchmark --engines [data directory] [output.csv] [tolerance] [batch output.csv]
+int engineSweep(int argc, char *argv[]);
+
+#endif /*!_ENGINESWEEP_HPP_*/
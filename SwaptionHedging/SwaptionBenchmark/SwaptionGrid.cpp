@@ -0,0 +1,79 @@
+#include "SwaptionGrid.hpp"
+#include "../SwaptionHedging/Market.hpp"
+#include "../SwaptionHedging/MarketData.hpp"
+#include "../SwaptionHedging/Portfolio.hpp"
+
+using namespace QuantLib;
+using namespace std;
+
+GridMarket loadGridMarket(const string &directory, const string &dateString) {
+	GridMarket m;
+	m.today = stringToDate(dateString);
+	Settings::instance().evaluationDate() = m.today;
+	m.dfs = DiscountFactorVec(directory + "DF_" + dateString + ".csv");
+	m.vols = ImpliedVolatilityVec(directory + "IV_" + dateString + ".csv");
+	m.curve = buildCurve(m.today, m.dfs);
+	m.index = boost::shared_ptr<IborIndex>(new Euribor3M(m.curve));
+	return m;
+}
+
+Handle<YieldTermStructure> buildCurve(const Date &today, const vector<DiscountFactor> &dfs) {
+	vector<Period> pillars = curvePillars();
+	vector<Date> dates;
+	for (Size i = 0; i < pillars.size(); i++)
+		dates.push_back(today + pillars[i]);
+	return Handle<YieldTermStructure>(boost::shared_ptr<YieldTermStructure>(
+		new InterpolatedDiscountCurve<Linear>(dates, dfs, EURLibor1M().dayCounter(), TARGET())));
+}
+
+vector<boost::shared_ptr<CalibrationHelper> > gridHelpers(const GridMarket &market, bool diagonalOnly,
+	const boost::shared_ptr<PricingEngine> &engine) {
+	vector<boost::shared_ptr<CalibrationHelper> > helpers;
+	for (Size i = 0; i < 10; i++)
+		for (Size j = 0; j < 10; j++) {
+			if (diagonalOnly && i + j != 9)
+				continue;
+			boost::shared_ptr<Quote> vol(new SimpleQuote(market.vols[i * 10 + j]));
+			helpers.push_back(boost::shared_ptr<CalibrationHelper>(new
+				SwaptionHelper(Period(i + 1, Years),
+					Period(j + 1, Years),
+					Handle<Quote>(vol),
+					market.index,
+					market.index->tenor(),
+					market.index->dayCounter(),
+					market.index->dayCounter(),
+					market.curve)));
+			helpers.back()->setPricingEngine(engine);
+		}
+	return helpers;
+}
+
+vector<GridSwaption> atmGrid(const GridMarket &market) {
+	boost::shared_ptr<PricingEngine> swapEngine(new DiscountingSwapEngine(market.curve));
+	vector<GridSwaption> grid;
+	for (Integer i = 1; i <= 10; i++)
+		for (Integer j = 1; j <= 10; j++) {
+			Schedule fixedSchedule = fixedLegSchedule(market.today, i, j);
+			Schedule floatSchedule = floatingLegSchedule(market.today, i, j);
+			VanillaSwap unitSwap(VanillaSwap::Payer, 1.0,
+				fixedSchedule, 0.0, fixedLegDayCounter(),
+				floatSchedule, market.index, 0.0,
+				market.index->dayCounter());
+			unitSwap.setPricingEngine(swapEngine);
+
+			GridSwaption s;
+			s.maturity = i;
+			s.tenor = j;
+			s.annuity = -unitSwap.fixedLegBPS() / 1.0e-4;
+			s.strike = unitSwap.floatingLegNPV() / s.annuity;
+			boost::shared_ptr<VanillaSwap> swap(new VanillaSwap(VanillaSwap::Payer, 1.0,
+				fixedSchedule, s.strike, fixedLegDayCounter(),
+				floatSchedule, market.index, 0.0,
+				market.index->dayCounter()));
+			swap->setPricingEngine(swapEngine);
+			boost::shared_ptr<Exercise> europeanExercise(new EuropeanExercise(fixedSchedule.startDate()));
+			s.swaption = boost::shared_ptr<Swaption>(new Swaption(swap, europeanExercise));
+			grid.push_back(s);
+		}
+	return grid;
+}
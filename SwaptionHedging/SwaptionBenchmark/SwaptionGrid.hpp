@@ -0,0 +1,41 @@
+#ifndef     _SWAPTIONGRID_HPP_
+# define    _SWAPTIONGRID_HPP_
+
+#include <ql/quantlib.hpp>
+#include <string>
+#include <vector>
+
+// This file and SwaptionGrid.cpp build the fixed inputs of the benchmarks from one date of the shipped
+// market data: the curve, the calibration baskets and the 10x10 grid of ATM swaptions. //
+
+struct GridMarket {
+	QuantLib::Date today;
+	std::vector<QuantLib::DiscountFactor> dfs;
+	std::vector<QuantLib::Volatility> vols; // 10x10, expiry by row
+	QuantLib::Handle<QuantLib::YieldTermStructure> curve;
+	boost::shared_ptr<QuantLib::IborIndex> index;
+};
+
+// reads DF_<date>.csv and IV_<date>.csv from the directory, which ends with a separator or is empty
+GridMarket loadGridMarket(const std::string &directory, const std::string &dateString);
+
+// the same linear discount curve as the hedging program, built from scratch
+QuantLib::Handle<QuantLib::YieldTermStructure> buildCurve(const QuantLib::Date &today,
+	const std::vector<QuantLib::DiscountFactor> &dfs);
+
+// swaption helpers of the whole surface, or of its co-terminal diagonal only
+std::vector<boost::shared_ptr<QuantLib::CalibrationHelper> > gridHelpers(const GridMarket &market,
+	bool diagonalOnly, const boost::shared_ptr<QuantLib::PricingEngine> &engine);
+
+struct GridSwaption {
+	QuantLib::Integer maturity;
+	QuantLib::Integer tenor;
+	QuantLib::Rate strike; // forward swap rate
+	QuantLib::Real annuity;
+	boost::shared_ptr<QuantLib::Swaption> swaption;
+};
+
+// at-the-money payer swaptions on a unit notional, 1-10Yr expiries and tenors, no engine set
+std::vector<GridSwaption> atmGrid(const GridMarket &market);
+
+#endif /*!_SWAPTIONGRID_HPP_*/
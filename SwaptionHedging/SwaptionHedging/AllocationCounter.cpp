@@ -0,0 +1,71 @@
+#include "AllocationCounter.hpp"
+#include "Arena.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// every allocation carries an AllocationHeader, so operator delete tells the arena ones from the heap ones
+
+#ifdef COUNT_ALLOCATIONS
+static std::atomic<std::size_t> allocations(0);
+static std::atomic<std::size_t> bytes(0);
+static std::atomic<std::size_t> arenaAllocations(0);
+static std::atomic<std::size_t> arenaBytes(0);
+#endif
+
+static void *allocation(std::size_t size) {
+	if (Arena *arena = Arena::current()) {
+#ifdef COUNT_ALLOCATIONS
+		arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+		arenaBytes.fetch_add(size, std::memory_order_relaxed);
+#endif
+		return arena->allocate(size);
+	}
+#ifdef COUNT_ALLOCATIONS
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(size, std::memory_order_relaxed);
+#endif
+	AllocationHeader *header = static_cast<AllocationHeader *>(std::malloc(sizeof(AllocationHeader) + size));
+	if (!header)
+		throw std::bad_alloc();
+	header->region = 0;
+	return header + 1;
+}
+
+static void deallocation(void *p) {
+	if (!p)
+		return;
+	AllocationHeader *header = static_cast<AllocationHeader *>(p) - 1;
+	if (header->region)
+		arenaDeallocate(header->region);
+	else
+		std::free(header);
+}
+
+void *operator new(std::size_t size) { return allocation(size); }
+void *operator new[](std::size_t size) { return allocation(size); }
+void operator delete(void *p) noexcept { deallocation(p); }
+void operator delete[](void *p) noexcept { deallocation(p); }
+void operator delete(void *p, std::size_t) noexcept { deallocation(p); }
+void operator delete[](void *p, std::size_t) noexcept { deallocation(p); }
+
+#ifdef COUNT_ALLOCATIONS
+
+bool allocationCounting() { return true; }
+
+AllocationCount allocationCount() {
+	AllocationCount c = { allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed),
+		arenaAllocations.load(std::memory_order_relaxed), arenaBytes.load(std::memory_order_relaxed) };
+	return c;
+}
+
+#else
+
+bool allocationCounting() { return false; }
+
+AllocationCount allocationCount() {
+	AllocationCount c = { 0, 0, 0, 0 };
+	return c;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef     _ALLOCATIONCOUNTER_HPP_
+# define    _ALLOCATIONCOUNTER_HPP_
+
+#include <cstddef>
+
+// allocations of the whole program through the global operator new of AllocationCounter.cpp, counted when
+// built with COUNT_ALLOCATIONS defined, always zero otherwise. The heap ones go to malloc, the arena ones
+// were made inside an ArenaScope (Arena.hpp) and would have gone to malloc without it
+struct AllocationCount {
+	std::size_t allocations;
+	std::size_t bytes;
+	std::size_t arenaAllocations;
+	std::size_t arenaBytes;
+};
+
+bool allocationCounting();
+AllocationCount allocationCount();
+
+#endif /*!_ALLOCATIONCOUNTER_HPP_*/
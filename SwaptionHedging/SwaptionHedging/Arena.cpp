@@ -0,0 +1,136 @@
+#include "Arena.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// the blocks come from malloc, never from operator new, which may be routed to this very arena
+struct ArenaBlock {
+	ArenaBlock *next;
+	std::size_t size; // of the allocations after it
+};
+
+struct ArenaRegion {
+	std::atomic<std::size_t> references; // one for the arena while it allocates in it, one per live allocation
+	ArenaBlock *first;
+	ArenaBlock *last;
+};
+
+static thread_local Arena *currentArena = 0;
+
+static ArenaRegion *newRegion() {
+	void *p = std::malloc(sizeof(ArenaRegion));
+	if (!p)
+		throw std::bad_alloc();
+	ArenaRegion *region = static_cast<ArenaRegion *>(p);
+	new (&region->references) std::atomic<std::size_t>(1);
+	region->first = 0;
+	region->last = 0;
+	return region;
+}
+
+static void freeBlocks(ArenaBlock *block) {
+	while (block) {
+		ArenaBlock *next = block->next;
+		std::free(block);
+		block = next;
+	}
+}
+
+static void freeRegion(ArenaRegion *region) {
+	freeBlocks(region->first);
+	std::free(region);
+}
+
+void arenaDeallocate(ArenaRegion *region) {
+	if (region->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		freeRegion(region);
+}
+
+Arena::Arena(std::size_t blockSize)
+	: blockSize_(blockSize), region_(0), cursor_(0), end_(0), allocations_(0), bytes_(0), blocks_(0),
+	totalAllocations_(0), keptAlive_(0) {}
+
+Arena::~Arena() {
+	if (region_)
+		arenaDeallocate(region_);
+}
+
+void Arena::addBlock(std::size_t size) {
+	if (!region_)
+		region_ = newRegion();
+	std::size_t n = size > blockSize_ ? size : blockSize_;
+	ArenaBlock *block = static_cast<ArenaBlock *>(std::malloc(sizeof(ArenaBlock) + n));
+	if (!block)
+		throw std::bad_alloc();
+	block->next = 0;
+	block->size = n;
+	if (region_->last)
+		region_->last->next = block;
+	else
+		region_->first = block;
+	region_->last = block;
+	cursor_ = reinterpret_cast<char *>(block + 1);
+	end_ = cursor_ + n;
+	blocks_++;
+}
+
+void *Arena::allocate(std::size_t size) {
+	std::size_t n = (sizeof(AllocationHeader) + size + 15) / 16 * 16;
+	if (std::size_t(end_ - cursor_) < n)
+		addBlock(n);
+	AllocationHeader *header = reinterpret_cast<AllocationHeader *>(cursor_);
+	header->region = region_;
+	cursor_ += n;
+	region_->references.fetch_add(1, std::memory_order_relaxed);
+	allocations_++;
+	bytes_ += size;
+	return header + 1;
+}
+
+std::size_t Arena::release() {
+	std::size_t alive = region_ ? region_->references.load(std::memory_order_acquire) - 1 : 0;
+	if (alive == 0) {
+		// nothing points into the blocks, the first one is kept for the next round
+		if (region_ && region_->first) {
+			freeBlocks(region_->first->next);
+			region_->first->next = 0;
+			region_->last = region_->first;
+			cursor_ = reinterpret_cast<char *>(region_->first + 1);
+			end_ = cursor_ + region_->first->size;
+			blocks_ = 1;
+		}
+	} else {
+		// the live allocations own the blocks now, the last one deleted frees them
+		arenaDeallocate(region_);
+		region_ = 0; // a new one with the next block
+		cursor_ = end_ = 0;
+		blocks_ = 0;
+	}
+	totalAllocations_ += allocations_;
+	keptAlive_ += alive;
+	allocations_ = 0;
+	bytes_ = 0;
+	return alive;
+}
+
+Arena *Arena::current() {
+	return currentArena;
+}
+
+ArenaScope::ArenaScope(Arena &arena, bool release) : arena_(&arena), previous_(currentArena), release_(release) {
+	currentArena = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+	currentArena = previous_;
+	if (release_)
+		arena_->release();
+}
+
+HeapScope::HeapScope() : previous_(currentArena) {
+	currentArena = 0;
+}
+
+HeapScope::~HeapScope() {
+	currentArena = previous_;
+}
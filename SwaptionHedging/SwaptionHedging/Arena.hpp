@@ -0,0 +1,84 @@
+#ifndef     _ARENA_HPP_
+# define    _ARENA_HPP_
+
+#include <cstddef>
+
+// This file and Arena.cpp give a thread a monotonic arena for everything it allocates while an ArenaScope is
+// open: the global operator new of AllocationCounter.cpp carves the allocations out of the arena's blocks and
+// operator delete only counts them off. release() starts over on the same blocks if nothing allocated since the
+// last release is still alive, otherwise the blocks stay until the last of those allocations is deleted, so an
+// object that outlives its round (a cached result, a string in an exception) is never left dangling. //
+
+struct ArenaRegion; // the blocks of one round between releases
+
+// in front of every allocation of the global operator new: the region of its arena, or null for the heap
+struct alignas(16) AllocationHeader {
+	ArenaRegion *region;
+};
+
+class Arena {
+public:
+	explicit Arena(std::size_t blockSize = 64 * 1024);
+	~Arena();
+
+	// size bytes after a header, 16 byte aligned
+	void *allocate(std::size_t size);
+	// starts a new round, returns the allocations of the last one that are still alive
+	std::size_t release();
+
+	std::size_t allocations() const { return allocations_; } // since the last release
+	std::size_t bytes() const { return bytes_; }
+	std::size_t blocks() const { return blocks_; }
+	std::size_t totalAllocations() const { return totalAllocations_ + allocations_; } // since construction
+	std::size_t keptAlive() const { return keptAlive_; } // all the releases returned
+
+	// the arena of the innermost ArenaScope open on this thread, null if none
+	static Arena *current();
+
+private:
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+	void addBlock(std::size_t size);
+	std::size_t blockSize_;
+	ArenaRegion *region_;
+	char *cursor_; // in the last block
+	char *end_;
+	std::size_t allocations_;
+	std::size_t bytes_;
+	std::size_t blocks_;
+	std::size_t totalAllocations_;
+	std::size_t keptAlive_;
+};
+
+// routes the operator new of this thread to the arena until destroyed, then releases it if asked to,
+// which makes a loop body declaring one a round of the arena
+class ArenaScope {
+public:
+	explicit ArenaScope(Arena &arena, bool release = false);
+	~ArenaScope(); // back to the scope open before, or to the heap
+
+private:
+	ArenaScope(const ArenaScope &);
+	ArenaScope &operator=(const ArenaScope &);
+	Arena *arena_;
+	Arena *previous_;
+	bool release_;
+};
+
+// routes the operator new of this thread to the heap until destroyed, for what outlives the round of the arena
+// open around it: the caches of long-lived objects, registries and the records of the run
+class HeapScope {
+public:
+	HeapScope();
+	~HeapScope(); // back to the arena open before, if any
+
+private:
+	HeapScope(const HeapScope &);
+	HeapScope &operator=(const HeapScope &);
+	Arena *previous_;
+};
+
+// operator delete of an allocation from the arena, the last one of a released region frees its blocks
+void arenaDeallocate(ArenaRegion *region);
+
+#endif /*!_ARENA_HPP_*/
@@ -0,0 +1,178 @@
+#include "BatchedFdHullWhite.hpp"
+#include "ParallelFor.hpp"
+#include "Counters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+std::vector<double> hullWhiteFdTimeGrid(const std::vector<HullWhiteFdSwaption> &swaptions, double maxStep) {
+	std::vector<double> mandatory;
+	for (std::size_t q = 0; q < swaptions.size(); q++)
+		mandatory.insert(mandatory.end(), swaptions[q].swaption.exerciseTimes.begin(),
+			swaptions[q].swaption.exerciseTimes.end());
+	return hwTimeGrid(mandatory, maxStep);
+}
+
+// the factored left hand side I - theta dt L(t_n) of one step back from t_n+1 to t_n, and the explicit
+// part I + (1 - theta) dt L(t_n+1) applied to the values at t_n+1
+struct FdStep {
+	double theta;
+	double dt;
+	std::vector<double> lower; // of the left hand side
+	std::vector<double> upper; // c' of the Thomas algorithm
+	std::vector<double> inverse; // 1 / pivot of the Thomas algorithm
+	std::vector<double> explicitDiagonal;
+};
+
+std::vector<double> priceHullWhiteFd(const HullWhiteFdSetup &setup, const std::vector<HullWhiteFdSwaption> &swaptions) {
+	std::size_t n = setup.xPoints, steps = setup.times.size() - 1, m = swaptions.size();
+	if (n < 3 || n % 2 == 0 || setup.times.size() < 2 || setup.alpha.size() != setup.times.size() || setup.lanes == 0)
+		throw std::runtime_error("inconsistent finite difference setup");
+	double a = setup.a, sigma = setup.sigma;
+
+	// uniform x grid around 0, L V = sigma^2 / 2 V'' - a x V' - (x + alpha) V; at the edges the drift points
+	// into the grid and the diffusion is dropped, with a one sided difference towards the inside
+	double T = setup.times.back();
+	double xMax = setup.xStdDevs * sigma * std::sqrt((1.0 - std::exp(-2.0 * a * T)) / (2.0 * a));
+	double dx = 2.0 * xMax / (n - 1);
+	std::vector<double> x(n), l(n, 0.0), d(n, 0.0), u(n, 0.0); // L without the - alpha V term
+	for (std::size_t i = 0; i < n; i++) {
+		x[i] = -xMax + i * dx;
+		double drift = -a * x[i];
+		if (i == 0) {
+			d[i] = -drift / dx;
+			u[i] = drift / dx;
+		} else if (i + 1 == n) {
+			l[i] = -drift / dx;
+			d[i] = drift / dx;
+		} else {
+			double diffusion = 0.5 * sigma * sigma / (dx * dx);
+			l[i] = diffusion - drift / (2.0 * dx);
+			d[i] = -2.0 * diffusion;
+			u[i] = diffusion + drift / (2.0 * dx);
+		}
+		d[i] -= x[i];
+	}
+
+	// exercises of every time, and the steps that follow one, going back, are damped
+	std::vector<std::vector<std::pair<std::size_t, std::size_t> > > exercises(setup.times.size());
+	for (std::size_t q = 0; q < m; q++) {
+		const BermudanSwaption &s = swaptions[q].swaption;
+		if (s.exerciseTimes.size() != swaptions[q].coeffs.size() || s.firstCoupon.size() != s.exerciseTimes.size())
+			throw std::runtime_error("inconsistent finite difference swaption");
+		for (std::size_t k = 0; k < s.exerciseTimes.size(); k++) {
+			std::vector<double>::const_iterator found = std::lower_bound(setup.times.begin(), setup.times.end(),
+				s.exerciseTimes[k] - 1.0e-10);
+			if (found == setup.times.end() || std::fabs(*found - s.exerciseTimes[k]) > 1.0e-10)
+				throw std::runtime_error("exercise time not on the finite difference grid");
+			exercises[found - setup.times.begin()].push_back(std::make_pair(q, k));
+		}
+	}
+
+	// every step is factored once for all blocks
+	std::vector<FdStep> factored(steps);
+	std::size_t damped = 0;
+	for (std::size_t s = steps; s-- > 0;) {
+		if (!exercises[s + 1].empty())
+			damped = setup.dampingSteps;
+		FdStep &step = factored[s];
+		step.theta = damped > 0 ? 1.0 : 0.5;
+		if (damped > 0)
+			damped--;
+		step.dt = setup.times[s + 1] - setup.times[s];
+		step.lower.resize(n);
+		step.upper.resize(n);
+		step.inverse.resize(n);
+		step.explicitDiagonal.resize(n);
+		double implicitDt = step.theta * step.dt, explicitDt = (1.0 - step.theta) * step.dt;
+		for (std::size_t i = 0; i < n; i++) {
+			step.lower[i] = -implicitDt * l[i];
+			double diagonal = 1.0 - implicitDt * (d[i] - setup.alpha[s]);
+			double pivot = diagonal - (i > 0 ? step.lower[i] * step.upper[i - 1] : 0.0);
+			step.inverse[i] = 1.0 / pivot;
+			step.upper[i] = -implicitDt * u[i] * step.inverse[i];
+			step.explicitDiagonal[i] = 1.0 + explicitDt * (d[i] - setup.alpha[s + 1]);
+		}
+	}
+
+	std::vector<double> values(m);
+	std::size_t blocks = (m + setup.lanes - 1) / setup.lanes, middle = (n - 1) / 2;
+	parallelFor(blocks, setup.threads, [&](std::size_t b) {
+		std::size_t first = b * setup.lanes, lanes = std::min(m, first + setup.lanes) - first;
+		// node by node, the swaptions of the block side by side
+		std::vector<double> v(n * lanes, 0.0), rhs(n * lanes);
+		auto exercise = [&](std::size_t t) {
+			for (std::size_t e = 0; e < exercises[t].size(); e++) {
+				std::size_t q = exercises[t][e].first, k = exercises[t][e].second;
+				if (q < first || q >= first + lanes)
+					continue;
+				const HullWhiteFdSwaption &s = swaptions[q];
+				for (std::size_t i = 0; i < n; i++) {
+					double h = bermudanExerciseValue(s.swaption, s.coeffs[k], k, x[i] + setup.alpha[t]);
+					double &value = v[i * lanes + q - first];
+					value = std::max(value, h);
+				}
+			}
+		};
+
+		exercise(steps);
+		for (std::size_t s = steps; s-- > 0;) {
+			const FdStep &step = factored[s];
+			double explicitDt = (1.0 - step.theta) * step.dt;
+			// explicit part
+			for (std::size_t i = 0; i < n; i++) {
+				double *r = &rhs[i * lanes];
+				const double *vi = &v[i * lanes];
+				double c = step.explicitDiagonal[i];
+				for (std::size_t j = 0; j < lanes; j++)
+					r[j] = c * vi[j];
+				if (explicitDt > 0.0) {
+					if (i > 0) {
+						const double *below = vi - lanes;
+						double cl = explicitDt * l[i];
+						for (std::size_t j = 0; j < lanes; j++)
+							r[j] += cl * below[j];
+					}
+					if (i + 1 < n) {
+						const double *above = vi + lanes;
+						double cu = explicitDt * u[i];
+						for (std::size_t j = 0; j < lanes; j++)
+							r[j] += cu * above[j];
+					}
+				}
+			}
+			// Thomas, forward then back, in place in rhs and then v
+			for (std::size_t i = 0; i < n; i++) {
+				double *r = &rhs[i * lanes];
+				double inverse = step.inverse[i];
+				if (i > 0) {
+					const double *previous = r - lanes;
+					double lower = step.lower[i];
+					for (std::size_t j = 0; j < lanes; j++)
+						r[j] = (r[j] - lower * previous[j]) * inverse;
+				} else {
+					for (std::size_t j = 0; j < lanes; j++)
+						r[j] *= inverse;
+				}
+			}
+			for (std::size_t i = n; i-- > 0;) {
+				double *vi = &v[i * lanes];
+				const double *r = &rhs[i * lanes];
+				if (i + 1 < n) {
+					const double *above = vi + lanes;
+					double upper = step.upper[i];
+					for (std::size_t j = 0; j < lanes; j++)
+						vi[j] = r[j] - upper * above[j];
+				} else {
+					for (std::size_t j = 0; j < lanes; j++)
+						vi[j] = r[j];
+				}
+			}
+			exercise(s);
+		}
+		for (std::size_t j = 0; j < lanes; j++)
+			values[first + j] = v[middle * lanes + j];
+	});
+	COUNT("finite difference swaptions", m);
+	return values;
+}
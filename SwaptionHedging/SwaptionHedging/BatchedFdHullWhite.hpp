@@ -0,0 +1,40 @@
+#ifndef     _BATCHEDFDHULLWHITE_HPP_
+# define    _BATCHEDFDHULLWHITE_HPP_
+
+#include "BermudanLSM.hpp"
+#include <vector>
+
+// This file and BatchedFdHullWhite.cpp solve the Hull-White pricing PDE in the OU factor x for many European and
+// Bermudan swaptions on one shared x grid and time grid, like FdHullWhiteSwaptionEngine does for one swaption.
+// The tridiagonal operator only depends on the grids and the curve, so every time step is factored once and
+// applied to a block of swaptions at the same time: the values of a block are stored node by node with the
+// swaptions of the block side by side, so the explicit step and both Thomas sweeps are loops over contiguous lanes,
+// which g++ vectorizes at -O3. Blocks run on separate threads; SwaptionBenchmark --engines times the price of a
+// swaption against the number of lanes. The exercise values come from the analytic bond prices of
+// HullWhiteAnalytics, no bond is rolled back on the grid. //
+
+// a swaption for the batched grid: BermudanSwaption with one exercise time is a European
+struct HullWhiteFdSwaption {
+	BermudanSwaption swaption; // a and sigma are those of the grid
+	std::vector<BondCoefficients> coeffs; // seen from every exercise time, as in BermudanLSMSetup
+};
+
+struct HullWhiteFdSetup {
+	double a;
+	double sigma;
+	std::vector<double> times; // today first, every exercise time on it
+	std::vector<double> alpha; // r = x + alpha at every time
+	std::size_t xPoints; // odd, so x = 0 is the middle point
+	double xStdDevs; // half width of the x grid in standard deviations of x at the last time
+	std::size_t dampingSteps; // fully implicit steps after every exercise time, Crank-Nicolson otherwise
+	std::size_t lanes; // swaptions per block
+	unsigned int threads;
+};
+
+// today, every exercise time of the swaptions and steps of at most maxStep between them
+std::vector<double> hullWhiteFdTimeGrid(const std::vector<HullWhiteFdSwaption> &swaptions, double maxStep);
+
+// values today
+std::vector<double> priceHullWhiteFd(const HullWhiteFdSetup &setup, const std::vector<HullWhiteFdSwaption> &swaptions);
+
+#endif /*!_BATCHEDFDHULLWHITE_HPP_*/
@@ -0,0 +1,282 @@
+#include "BermudanLSM.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+// the paths of one block on every exercise date, date by date: x[k * size + p]
+struct BermudanPathBlock {
+	std::size_t size;
+	std::vector<double> x;
+	std::vector<double> discount; // from today to the exercise date along the path
+	std::vector<double> exercise; // value of exercising, negative out of the money
+};
+
+// the three sets of paths have their own streams, one per block, so results do not depend on the number of threads
+static const unsigned long regressionSet = 0, pricingSet = 1, dualSet = 2;
+
+static std::mt19937_64 blockStream(unsigned long seed, unsigned long set, std::size_t block) {
+	std::seed_seq sequence = { seed, set, static_cast<unsigned long>(block) };
+	return std::mt19937_64(sequence);
+}
+
+static void advancePath(const HullWhiteStep &s, double alphaIntegral, std::mt19937_64 &rng,
+	std::normal_distribution<double> &gauss, double &x, double &discount) {
+	double z1 = gauss(rng), z2 = gauss(rng);
+	double y = x * s.mean + s.sdY * (s.rho * z1 + std::sqrt(1.0 - s.rho * s.rho) * z2);
+	x = x * s.decay + s.sdX * z1;
+	discount *= std::exp(-alphaIntegral - y);
+}
+
+double bermudanExerciseValue(const BermudanSwaption &swaption, const BondCoefficients &coeffs, std::size_t k, double r) {
+	std::size_t first = swaption.firstCoupon[k];
+	double value = coeffs.A[0] * std::exp(-coeffs.B[0] * r);
+	for (std::size_t i = first; i < swaption.coupons.size(); i++)
+		value -= swaption.coupons[i] * coeffs.A[i - first + 1] * std::exp(-coeffs.B[i - first + 1] * r);
+	return swaption.payer ? value : -value;
+}
+
+// regressed continuation value at scaled factor u, none fitted means exercise whenever in the money
+static double continuationValue(const std::vector<double> &beta, double u) {
+	double value = 0.0;
+	for (std::size_t j = beta.size(); j-- > 0;)
+		value = value * u + beta[j];
+	return value;
+}
+
+// normal equations m * beta = rhs of the basis, Gaussian elimination with partial pivoting
+static std::vector<double> solveNormalEquations(std::vector<double> m, std::vector<double> rhs) {
+	std::size_t n = rhs.size();
+	for (std::size_t c = 0; c < n; c++) {
+		std::size_t pivot = c;
+		for (std::size_t i = c + 1; i < n; i++)
+			if (std::fabs(m[i * n + c]) > std::fabs(m[pivot * n + c]))
+				pivot = i;
+		if (std::fabs(m[pivot * n + c]) < 1.0e-300)
+			return std::vector<double>();
+		for (std::size_t j = 0; j < n; j++)
+			std::swap(m[c * n + j], m[pivot * n + j]);
+		std::swap(rhs[c], rhs[pivot]);
+		for (std::size_t i = c + 1; i < n; i++) {
+			double f = m[i * n + c] / m[c * n + c];
+			for (std::size_t j = c; j < n; j++)
+				m[i * n + j] -= f * m[c * n + j];
+			rhs[i] -= f * rhs[c];
+		}
+	}
+	std::vector<double> beta(n);
+	for (std::size_t i = n; i-- > 0;) {
+		double sum = rhs[i];
+		for (std::size_t j = i + 1; j < n; j++)
+			sum -= m[i * n + j] * beta[j];
+		beta[i] = sum / m[i * n + i];
+	}
+	return beta;
+}
+
+static double mean(const std::vector<double> &values, double &stdError) {
+	double sum = 0.0, sum2 = 0.0;
+	for (std::size_t i = 0; i < values.size(); i++) {
+		sum += values[i];
+		sum2 += values[i] * values[i];
+	}
+	double n = static_cast<double>(values.size());
+	double m = sum / n;
+	stdError = n > 1 ? std::sqrt(std::max(0.0, (sum2 - n * m * m) / (n - 1)) / n) : 0.0;
+	return m;
+}
+
+BermudanLSMResults priceBermudanLSM(const BermudanLSMSetup &setup) {
+	const BermudanSwaption &swaption = setup.swaption;
+	std::size_t dates = swaption.exerciseTimes.size();
+	if (dates == 0 || setup.alpha.size() != dates || setup.alphaIntegral.size() != dates
+		|| setup.coeffs.size() != dates || swaption.firstCoupon.size() != dates || setup.basisSize == 0)
+		throw std::runtime_error("inconsistent Bermudan swaption setup");
+	double a = swaption.a, sigma = swaption.sigma;
+	std::size_t n = setup.basisSize;
+
+	// exact transitions from today to the first exercise date and between exercise dates, and the
+	// standard deviation of the factor on every date that scales the regression basis
+	std::vector<HullWhiteStep> steps(dates);
+	std::vector<double> scale(dates);
+	for (std::size_t k = 0; k < dates; k++) {
+		double t0 = k > 0 ? swaption.exerciseTimes[k - 1] : 0.0, t = swaption.exerciseTimes[k];
+		steps[k] = hwExactStep(a, sigma, t - t0);
+		scale[k] = 1.0 / (sigma * std::sqrt((1.0 - std::exp(-2.0 * a * t)) / (2.0 * a)));
+	}
+
+	// the block is simulated date by date, so the state of all its paths on a date is one contiguous row
+	auto simulateBlock = [&](std::size_t size, std::mt19937_64 &rng) {
+		std::normal_distribution<double> gauss;
+		BermudanPathBlock block;
+		block.size = size;
+		block.x.resize(dates * size);
+		block.discount.resize(dates * size);
+		block.exercise.resize(dates * size);
+		std::vector<double> x(size, 0.0), discount(size, 1.0);
+		for (std::size_t k = 0; k < dates; k++) {
+			double *xRow = &block.x[k * size], *discountRow = &block.discount[k * size], *exerciseRow = &block.exercise[k * size];
+			for (std::size_t p = 0; p < size; p++) {
+				advancePath(steps[k], setup.alphaIntegral[k], rng, gauss, x[p], discount[p]);
+				xRow[p] = x[p];
+				discountRow[p] = discount[p];
+				exerciseRow[p] = bermudanExerciseValue(swaption, setup.coeffs[k], k, x[p] + setup.alpha[k]);
+			}
+		}
+		return block;
+	};
+	auto blockCount = [&](std::size_t paths) { return (paths + setup.blockSize - 1) / setup.blockSize; };
+	auto blockSize = [&](std::size_t paths, std::size_t b) { return std::min(paths, (b + 1) * setup.blockSize) - b * setup.blockSize; };
+
+	BermudanLSMResults results;
+	results.coefficients.resize(dates);
+	std::vector<std::vector<double> > valueCoefficients(dates);
+
+	// regression paths, backwards from the last date: cash flows are discounted to today
+	std::size_t blocks = blockCount(setup.regressionPaths);
+	std::vector<BermudanPathBlock> regression(blocks);
+	std::vector<std::vector<double> > cashFlows(blocks);
+	parallelFor(blocks, setup.threads, [&](std::size_t b) {
+		std::mt19937_64 rng = blockStream(setup.seed, regressionSet, b);
+		regression[b] = simulateBlock(blockSize(setup.regressionPaths, b), rng);
+		const BermudanPathBlock &block = regression[b];
+		std::size_t last = (dates - 1) * block.size;
+		cashFlows[b].resize(block.size);
+		for (std::size_t p = 0; p < block.size; p++)
+			cashFlows[b][p] = block.exercise[last + p] > 0.0 ? block.discount[last + p] * block.exercise[last + p] : 0.0;
+	});
+	// the normal equations of the paths in the money, for the exercise decision, then of all paths, for the
+	// value of the policy the dual needs out of the money too; each is the matrix, the right hand side and a count
+	std::size_t equations = n * n + n + 1;
+	std::vector<std::vector<double> > normal(blocks, std::vector<double>(2 * equations));
+	for (std::size_t k = dates - 1; k-- > 0;) {
+		// every block sums the normal equations of its paths, valued in the money of the date
+		parallelFor(blocks, setup.threads, [&](std::size_t b) {
+			const BermudanPathBlock &block = regression[b];
+			std::vector<double> &sums = normal[b];
+			std::fill(sums.begin(), sums.end(), 0.0);
+			std::vector<double> basis(n);
+			for (std::size_t p = 0; p < block.size; p++) {
+				std::size_t i = k * block.size + p;
+				double u = block.x[i] * scale[k], y = cashFlows[b][p] / block.discount[i];
+				basis[0] = 1.0;
+				for (std::size_t j = 1; j < n; j++)
+					basis[j] = basis[j - 1] * u;
+				for (std::size_t set = (block.exercise[i] > 0.0 ? 0 : 1); set < 2; set++) {
+					double *e = &sums[set * equations];
+					for (std::size_t r = 0; r < n; r++) {
+						for (std::size_t c = 0; c < n; c++)
+							e[r * n + c] += basis[r] * basis[c];
+						e[n * n + r] += basis[r] * y;
+					}
+					e[n * n + n] += 1.0;
+				}
+			}
+		});
+		for (std::size_t set = 0; set < 2; set++) {
+			std::vector<double> m(n * n, 0.0), rhs(n, 0.0);
+			double count = 0.0;
+			for (std::size_t b = 0; b < blocks; b++) { // in block order, the same sums for any number of threads
+				const double *e = &normal[b][set * equations];
+				for (std::size_t j = 0; j < n * n; j++)
+					m[j] += e[j];
+				for (std::size_t j = 0; j < n; j++)
+					rhs[j] += e[n * n + j];
+				count += e[n * n + n];
+			}
+			if (count > n)
+				(set == 0 ? results.coefficients[k] : valueCoefficients[k]) = solveNormalEquations(m, rhs);
+		}
+		const std::vector<double> &beta = results.coefficients[k];
+
+		parallelFor(blocks, setup.threads, [&](std::size_t b) {
+			const BermudanPathBlock &block = regression[b];
+			for (std::size_t p = 0; p < block.size; p++) {
+				std::size_t i = k * block.size + p;
+				if (block.exercise[i] > 0.0 && block.exercise[i] >= continuationValue(beta, block.x[i] * scale[k]))
+					cashFlows[b][p] = block.discount[i] * block.exercise[i];
+			}
+		});
+	}
+	std::vector<double> inSample;
+	for (std::size_t b = 0; b < blocks; b++)
+		inSample.insert(inSample.end(), cashFlows[b].begin(), cashFlows[b].end());
+	double inSampleError;
+	results.inSample = mean(inSample, inSampleError);
+	regression.clear();
+
+	// exercise at the first date the exercise value beats the regressed continuation value
+	auto exercises = [&](const BermudanPathBlock &block, std::size_t k, std::size_t p) {
+		std::size_t i = k * block.size + p;
+		return block.exercise[i] > 0.0 && (k + 1 == dates
+			|| block.exercise[i] >= continuationValue(results.coefficients[k], block.x[i] * scale[k]));
+	};
+
+	// the value of the policy on a date, its exercise value or its regressed value
+	auto policyValue = [&](std::size_t k, double x) {
+		double exercise = bermudanExerciseValue(swaption, setup.coeffs[k], k, x + setup.alpha[k]);
+		double u = x * scale[k];
+		if (exercise > 0.0 && (k + 1 == dates || exercise >= continuationValue(results.coefficients[k], u)))
+			return exercise;
+		return k + 1 == dates ? 0.0 : std::max(0.0, continuationValue(valueCoefficients[k], u));
+	};
+
+	// lower bound on paths independent of the regression; they also give the expected value of the policy on the
+	// first exercise date, the first increment of the dual's martingale
+	blocks = blockCount(setup.pricingPaths);
+	std::vector<double> payoffs(setup.pricingPaths, 0.0), startValues(setup.pricingPaths);
+	std::vector<std::vector<std::size_t> > exerciseCounts(blocks, std::vector<std::size_t>(dates, 0));
+	parallelFor(blocks, setup.threads, [&](std::size_t b) {
+		std::mt19937_64 rng = blockStream(setup.seed, pricingSet, b);
+		BermudanPathBlock block = simulateBlock(blockSize(setup.pricingPaths, b), rng);
+		for (std::size_t p = 0; p < block.size; p++) {
+			startValues[b * setup.blockSize + p] = block.discount[p] * policyValue(0, block.x[p]);
+			for (std::size_t k = 0; k < dates; k++)
+				if (exercises(block, k, p)) {
+					std::size_t i = k * block.size + p;
+					payoffs[b * setup.blockSize + p] = block.discount[i] * block.exercise[i];
+					exerciseCounts[b][k]++;
+					break;
+				}
+		}
+	});
+	results.lowerBound = mean(payoffs, results.lowerStdError);
+	double startError;
+	double expectedStart = mean(startValues, startError);
+	results.exerciseProbability.assign(dates, 0.0);
+	for (std::size_t b = 0; b < blocks; b++)
+		for (std::size_t k = 0; k < dates; k++)
+			results.exerciseProbability[k] += double(exerciseCounts[b][k]) / setup.pricingPaths;
+
+	// upper bound: the largest discounted exercise value less the martingale of the increments of the policy
+	// value less their conditional expectation, from inner paths after the first date
+	blocks = blockCount(setup.dualPaths);
+	std::vector<double> duals(setup.dualPaths);
+	parallelFor(blocks, setup.threads, [&](std::size_t b) {
+		std::mt19937_64 rng = blockStream(setup.seed, dualSet, b);
+		std::normal_distribution<double> gauss;
+		BermudanPathBlock block = simulateBlock(blockSize(setup.dualPaths, b), rng);
+		for (std::size_t p = 0; p < block.size; p++) {
+			double martingale = block.discount[p] * policyValue(0, block.x[p]) - expectedStart;
+			double dual = block.discount[p] * std::max(0.0, block.exercise[p]) - martingale;
+			for (std::size_t k = 1; k < dates; k++) {
+				std::size_t i = k * block.size + p, previous = (k - 1) * block.size + p;
+				double expected = 0.0;
+				for (std::size_t j = 0; j < setup.innerPaths; j++) {
+					double x = block.x[previous], discount = 1.0;
+					advancePath(steps[k], setup.alphaIntegral[k], rng, gauss, x, discount);
+					expected += discount * policyValue(k, x);
+				}
+				expected *= block.discount[previous] / setup.innerPaths;
+				martingale += block.discount[i] * policyValue(k, block.x[i]) - expected;
+				dual = std::max(dual, block.discount[i] * std::max(0.0, block.exercise[i]) - martingale);
+			}
+			duals[b * setup.blockSize + p] = dual;
+		}
+	});
+	results.upperBound = mean(duals, results.upperStdError);
+	// the first increment is centred on an estimate, its error adds to the dual's
+	results.upperStdError = std::sqrt(results.upperStdError * results.upperStdError + startError * startError);
+	return results;
+}
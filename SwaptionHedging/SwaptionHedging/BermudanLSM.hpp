@@ -0,0 +1,58 @@
+#ifndef     _BERMUDANLSM_HPP_
+# define    _BERMUDANLSM_HPP_
+
+#include "HullWhiteAnalytics.hpp"
+#include <vector>
+
+// This file and BermudanLSM.cpp price a Bermudan swaption in the Hull-White One Factor model by Longstaff-Schwartz
+// Monte Carlo, with no QuantLib objects. The short rate is simulated exactly from one exercise date to the next
+// together with its integral, so every path carries its own stochastic discount factor. Paths live in blocks that
+// have their own random stream and keep the state of their paths date by date in contiguous arrays; the regression
+// of every exercise date sums the normal equations of the blocks, in parallel, and solves one small least squares
+// problem. The exercise policy fitted on one set of paths prices an independent set for a lower bound, and the
+// Andersen-Broadie dual with the martingale of the same policy, from inner paths, gives an upper bound. //
+
+// exercisable on every exercise time into the swap of the remaining fixed leg payments, unit notional
+struct BermudanSwaption {
+	double a;
+	double sigma;
+	std::vector<double> exerciseTimes; // increasing, the swap starts on the exercise date
+	std::vector<std::size_t> firstCoupon; // index of the first payment after every exercise time
+	std::vector<double> payTimes; // fixed leg payment times of the longest swap
+	std::vector<double> coupons; // strike * accrual, the last one includes the notional
+	bool payer;
+};
+
+struct BermudanLSMSetup {
+	BermudanSwaption swaption;
+	std::vector<double> alpha; // r(t) = x(t) + alpha(t) at every exercise time
+	std::vector<double> alphaIntegral; // integral of alpha up to the first exercise time, then between exercise times
+	// seen from every exercise time, the swap start (index 0) is the exercise time and index 1.. are the
+	// payments from firstCoupon on, as in HullWhiteAnalytics
+	std::vector<BondCoefficients> coeffs;
+	std::size_t basisSize; // 1, u, u^2, ... of the factor x scaled by its standard deviation
+	std::size_t regressionPaths;
+	std::size_t pricingPaths;
+	std::size_t dualPaths;
+	std::size_t innerPaths; // per dual path and exercise date, for the martingale of the upper bound
+	std::size_t blockSize; // paths per block, every block has its own random stream
+	unsigned long seed;
+	unsigned int threads;
+};
+
+struct BermudanLSMResults {
+	double lowerBound; // the fitted policy on the pricing paths, biased low
+	double lowerStdError;
+	double upperBound; // the dual on the dual paths, biased high
+	double upperStdError;
+	double inSample; // the fitted policy on the regression paths themselves
+	std::vector<std::vector<double> > coefficients; // of the continuation value at every exercise date, none at the last
+	std::vector<double> exerciseProbability; // of the pricing paths at every exercise date
+};
+
+// value of the underlying swap entered at exercise date k (payer: floating minus fixed) for short rate r
+double bermudanExerciseValue(const BermudanSwaption &swaption, const BondCoefficients &coeffs, std::size_t k, double r);
+
+BermudanLSMResults priceBermudanLSM(const BermudanLSMSetup &setup);
+
+#endif /*!_BERMUDANLSM_HPP_*/
@@ -0,0 +1,88 @@
+#include "BitmapCalendar.hpp"
+
+using namespace QuantLib;
+using namespace std;
+
+BitmapCalendar::Impl::Impl(const Calendar &calendar, Year firstYear, Year lastYear)
+	: calendar_(calendar) {
+	QL_REQUIRE(firstYear <= lastYear, "no years from " << firstYear << " to " << lastYear);
+	first_ = Date(1, January, firstYear);
+	last_ = Date(31, December, lastYear);
+	Size days = Size(last_ - first_) + 1;
+	business_.resize(days);
+	before_.resize(days + 1);
+	before_[0] = 0;
+	for (Size i = 0; i < days; i++) {
+		business_[i] = calendar_.isBusinessDay(first_ + BigInteger(i));
+		before_[i + 1] = before_[i] + (business_[i] ? 1 : 0);
+		if (business_[i])
+			businessDays_.push_back(i);
+	}
+}
+
+bool BitmapCalendar::Impl::isBusinessDay(const Date &d) const {
+	if (inRange(d))
+		return business_[Size(d - first_)];
+	return calendar_.isBusinessDay(d);
+}
+
+BitmapCalendar::BitmapCalendar(const Calendar &calendar, Year firstYear, Year lastYear)
+	: bitmap_(new Impl(calendar, firstYear, lastYear)) {
+	impl_ = bitmap_;
+}
+
+Date BitmapCalendar::adjust(const Date &d, BusinessDayConvention convention) const {
+	QL_REQUIRE(d != Date(), "null date");
+	if (convention == Unadjusted || !bitmap_->inRange(d))
+		return Calendar::adjust(d, convention);
+
+	if (convention == Following || convention == ModifiedFollowing) {
+		Date d1 = bitmap_->businessDay(bitmap_->countBefore(d)); // the first one on or after d
+		if (d1 == Date())
+			return Calendar::adjust(d, convention);
+		if (convention == ModifiedFollowing && d1.month() != d.month())
+			return adjust(d, Preceding);
+		return d1;
+	}
+	if (convention == Preceding || convention == ModifiedPreceding) {
+		Size through = bitmap_->countBefore(d + 1); // business days up to and including d
+		if (through == 0)
+			return Calendar::adjust(d, convention);
+		Date d1 = bitmap_->businessDay(through - 1);
+		if (convention == ModifiedPreceding && d1.month() != d.month())
+			return adjust(d, Following);
+		return d1;
+	}
+	return Calendar::adjust(d, convention); // Nearest, half month, ... still use the bitmap day by day
+}
+
+Date BitmapCalendar::advance(const Date &d, Integer n, TimeUnit unit,
+	BusinessDayConvention convention, bool endOfMonth) const {
+	QL_REQUIRE(d != Date(), "null date");
+	if (n == 0)
+		return adjust(d, convention);
+
+	if (unit == Days) {
+		if (bitmap_->inRange(d)) {
+			Date d1;
+			if (n > 0)
+				d1 = bitmap_->businessDay(bitmap_->countBefore(d + 1) + Size(n) - 1);
+			else if (bitmap_->countBefore(d) >= Size(-n))
+				d1 = bitmap_->businessDay(bitmap_->countBefore(d) - Size(-n));
+			if (d1 != Date())
+				return d1;
+		}
+		return Calendar::advance(d, n, unit, convention, endOfMonth);
+	}
+
+	// as in QuantLib, end of month only applies to months and years
+	Date d1 = d + n * unit;
+	if (unit != Weeks && endOfMonth && d.month() != adjust(d + 1).month())
+		return adjust(Date::endOfMonth(d1), Preceding);
+	return adjust(d1, convention);
+}
+
+Date BitmapCalendar::advance(const Date &d, const Period &period,
+	BusinessDayConvention convention, bool endOfMonth) const {
+	return advance(d, period.length(), period.units(), convention, endOfMonth);
+}
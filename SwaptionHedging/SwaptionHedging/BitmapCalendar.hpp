@@ -0,0 +1,51 @@
+#ifndef     _BITMAPCALENDAR_HPP_
+# define    _BITMAPCALENDAR_HPP_
+
+#include <ql/quantlib.hpp>
+#include <vector>
+
+// This file and BitmapCalendar.cpp wrap a QuantLib calendar, TARGET for the swap legs, in one that evaluates
+// the holiday rules (Easter included) once per day of a range of years up front. isBusinessDay is then a
+// lookup in a bitmap, and advance by business days and the usual adjustments are a lookup in the business
+// day counts, instead of a day by day walk that evaluates the rules again for every day it passes. Outside
+// the range, and for the conventions it does not handle, it falls back to the wrapped calendar. //
+
+class BitmapCalendar : public QuantLib::Calendar {
+public:
+	BitmapCalendar(const QuantLib::Calendar &calendar, QuantLib::Year firstYear, QuantLib::Year lastYear);
+
+	// the same results as QuantLib::Calendar, which still calls these through isBusinessDay when it is used
+	// as a plain Calendar, e.g. by a Schedule; these hide the day by day versions of the base class
+	QuantLib::Date adjust(const QuantLib::Date &d,
+		QuantLib::BusinessDayConvention convention = QuantLib::Following) const;
+	QuantLib::Date advance(const QuantLib::Date &d, QuantLib::Integer n, QuantLib::TimeUnit unit,
+		QuantLib::BusinessDayConvention convention = QuantLib::Following, bool endOfMonth = false) const;
+	QuantLib::Date advance(const QuantLib::Date &d, const QuantLib::Period &period,
+		QuantLib::BusinessDayConvention convention = QuantLib::Following, bool endOfMonth = false) const;
+
+private:
+	class Impl : public QuantLib::Calendar::Impl {
+	public:
+		Impl(const QuantLib::Calendar &calendar, QuantLib::Year firstYear, QuantLib::Year lastYear);
+		std::string name() const { return calendar_.name(); } // the same name, so it compares equal
+		bool isWeekend(QuantLib::Weekday w) const { return calendar_.isWeekend(w); }
+		bool isBusinessDay(const QuantLib::Date &d) const;
+
+		bool inRange(const QuantLib::Date &d) const { return d >= first_ && d <= last_; }
+		// business days before d, d in range
+		QuantLib::Size countBefore(const QuantLib::Date &d) const { return before_[QuantLib::Size(d - first_)]; }
+		// the k-th business day of the range from 0, or a null Date past its end
+		QuantLib::Date businessDay(QuantLib::Size k) const {
+			return k < businessDays_.size() ? first_ + QuantLib::BigInteger(businessDays_[k]) : QuantLib::Date();
+		}
+
+		QuantLib::Calendar calendar_;
+		QuantLib::Date first_, last_;
+		std::vector<bool> business_; // by day from first_
+		std::vector<QuantLib::Size> before_; // business days before each day, one more entry for the day after last_
+		std::vector<QuantLib::Size> businessDays_; // days from first_ of every business day
+	};
+	boost::shared_ptr<Impl> bitmap_; // the same object as impl_
+};
+
+#endif /*!_BITMAPCALENDAR_HPP_*/
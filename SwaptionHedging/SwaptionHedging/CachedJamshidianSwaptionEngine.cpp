@@ -0,0 +1,95 @@
+#include "CachedJamshidianSwaptionEngine.hpp"
+#include "Counters.hpp"
+#include "Arena.hpp"
+
+using namespace QuantLib;
+
+// HullWhite::B, with the same cut-off for a vanishing mean reversion
+static Real hullWhiteB(Real a, Time tau) {
+	if (a < std::sqrt(QL_EPSILON))
+		return tau;
+	return (1.0 - std::exp(-a * tau)) / a;
+}
+
+CachedJamshidianSwaptionEngine::CachedJamshidianSwaptionEngine(const boost::shared_ptr<HullWhite> &model)
+	: GenericModelEngine<HullWhite, Swaption::arguments, Swaption::results>(model) {}
+
+void CachedJamshidianSwaptionEngine::update() {
+	expiries_.clear(); // new parameters, a new curve or a new evaluation date
+	GenericModelEngine<HullWhite, Swaption::arguments, Swaption::results>::update();
+}
+
+const CachedJamshidianSwaptionEngine::PayDate &CachedJamshidianSwaptionEngine::payDate(
+	Expiry &expiry, const Date &date) const {
+	std::map<Date, PayDate>::iterator found = expiry.payDates.find(date);
+	if (found != expiry.payDates.end())
+		return found->second;
+
+	// the same terms as HullWhite::A and HullWhite::discountBondOption
+	const Handle<YieldTermStructure> &termStructure = model_->termStructure();
+	Time t = termStructure->dayCounter().yearFraction(termStructure->referenceDate(), date);
+	Real sigma = model_->sigma();
+	PayDate d;
+	d.B = hullWhiteB(model_->a(), t - expiry.time);
+	d.discount = termStructure->discount(t);
+	Real temp = sigma * d.B;
+	d.A = std::exp(d.B * expiry.forward - 0.25 * temp * temp * expiry.varianceFactor) * d.discount / expiry.discount;
+	d.stdDev = temp * std::sqrt(0.5 * expiry.varianceFactor);
+	HeapScope heap; // the cache lives as long as the engine, not the arena of the calculation
+	return expiry.payDates[date] = d;
+}
+
+void CachedJamshidianSwaptionEngine::calculate() const {
+	QL_REQUIRE(arguments_.settlementType == Settlement::Physical, "cash-settled swaptions not priced by Jamshidian engine");
+	QL_REQUIRE(arguments_.exercise->type() == Exercise::European, "cannot use the Jamshidian decomposition on exotic swaptions");
+	QL_REQUIRE(arguments_.nominal != Null<Real>(), "non-constant nominals are not supported yet");
+
+	Date exerciseDate = arguments_.exercise->date(0);
+	std::map<Date, Expiry>::iterator found = expiries_.find(exerciseDate);
+	if (found == expiries_.end()) {
+		COUNT("cached jamshidian expiries", 1);
+		const Handle<YieldTermStructure> &termStructure = model_->termStructure();
+		Expiry expiry;
+		expiry.time = termStructure->dayCounter().yearFraction(termStructure->referenceDate(), exerciseDate);
+		expiry.discount = termStructure->discount(expiry.time);
+		expiry.forward = termStructure->forwardRate(expiry.time, expiry.time, Continuous, NoFrequency);
+		expiry.varianceFactor = hullWhiteB(model_->a(), 2.0 * expiry.time);
+		expiry.criticalRate = 0.05;
+		HeapScope heap;
+		found = expiries_.insert(std::make_pair(exerciseDate, expiry)).first;
+	}
+	Expiry &expiry = found->second;
+
+	Size n = arguments_.fixedCoupons.size();
+	std::vector<Real> amounts(arguments_.fixedCoupons);
+	amounts.back() += arguments_.nominal;
+	std::vector<const PayDate *> dates(n);
+	for (Size i = 0; i < n; i++)
+		dates[i] = &payDate(expiry, arguments_.fixedPayDates[i]);
+
+	// the coupon bond is decreasing and convex in r, Newton converges from either side of the root
+	Rate r = expiry.criticalRate;
+	for (Size iteration = 0;; iteration++) {
+		Real f = -arguments_.nominal, df = 0.0;
+		for (Size i = 0; i < n; i++) {
+			Real P = dates[i]->A * std::exp(-dates[i]->B * r);
+			f += amounts[i] * P;
+			df -= amounts[i] * dates[i]->B * P;
+		}
+		Real step = f / df;
+		r -= step;
+		if (std::fabs(step) < 1.0e-14)
+			break;
+		QL_REQUIRE(iteration < 100, "Jamshidian critical rate did not converge");
+	}
+	expiry.criticalRate = r;
+
+	// payer swaption = put on the coupon bond, receiver swaption = call
+	Option::Type w = (arguments_.type == VanillaSwap::Payer) ? Option::Put : Option::Call;
+	Real value = 0.0;
+	for (Size i = 0; i < n; i++) {
+		Real strike = dates[i]->A * std::exp(-dates[i]->B * r);
+		value += amounts[i] * blackFormula(w, expiry.discount * strike, dates[i]->discount, dates[i]->stdDev);
+	}
+	results_.value = value;
+}
@@ -0,0 +1,42 @@
+#ifndef     _CACHEDJAMSHIDIANSWAPTIONENGINE_HPP_
+# define    _CACHEDJAMSHIDIANSWAPTIONENGINE_HPP_
+
+#include <ql/quantlib.hpp>
+#include <map>
+
+// This file and CachedJamshidianSwaptionEngine.cpp price European swaptions in the Hull-White model like
+// JamshidianSwaptionEngine, with the work that depends on the expiry only done once for all swaptions of
+// that expiry: the affine bond coefficients A(T,t) and B(T,t), the discount factors and the bond option
+// volatilities of every payment date. The swaptions of one expiry share their payment dates (tenors are
+// prefixes of each other), so a 10x10 grid needs the coefficients of 10 expiries and 20 dates each instead
+// of calling HullWhite::discountBond in every step of a root search per swaption. The critical rate is
+// solved by Newton on the cached coefficients, starting from the previous swaption of the expiry.
+// The cache is dropped whenever the model or its curve notify the engine. //
+
+class CachedJamshidianSwaptionEngine : public QuantLib::GenericModelEngine<QuantLib::HullWhite,
+	QuantLib::Swaption::arguments, QuantLib::Swaption::results> {
+public:
+	explicit CachedJamshidianSwaptionEngine(const boost::shared_ptr<QuantLib::HullWhite> &model);
+	void calculate() const;
+	void update();
+
+private:
+	struct PayDate {
+		QuantLib::Real A;
+		QuantLib::Real B;
+		QuantLib::DiscountFactor discount; // P(0, t)
+		QuantLib::Real stdDev; // of the forward bond price P(T, t) / P(T) up to the expiry
+	};
+	struct Expiry {
+		QuantLib::Time time;
+		QuantLib::DiscountFactor discount; // P(0, T)
+		QuantLib::Rate forward; // instantaneous forward at T
+		QuantLib::Real varianceFactor; // B(0, 2T), the short rate variance is sigma^2 * B(0, 2T) / 2
+		QuantLib::Rate criticalRate; // of the last swaption priced, the next Newton search starts there
+		std::map<QuantLib::Date, PayDate> payDates;
+	};
+	const PayDate &payDate(Expiry &expiry, const QuantLib::Date &date) const;
+	mutable std::map<QuantLib::Date, Expiry> expiries_;
+};
+
+#endif /*!_CACHEDJAMSHIDIANSWAPTIONENGINE_HPP_*/
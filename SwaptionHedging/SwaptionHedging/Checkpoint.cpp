@@ -0,0 +1,119 @@
+#include "Checkpoint.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+static const char checkpointMagic[4] = { 'S', 'W', 'C', 'K' };
+static const uint32_t checkpointVersion = 1;
+static const size_t recordDoubles = 9; // a, sigma, ..., cumulative PnL
+
+template <class T>
+static bool readValue(istream &in, T &value) {
+	return bool(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+template <class T>
+static void writeValue(ostream &out, const T &value) {
+	out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+uint64_t fileHash(const string &filename) {
+	ifstream in(filename.c_str(), ios::in | ios::binary);
+	if (!in.is_open())
+		throw runtime_error("cannot read " + filename);
+	uint64_t hash = 14695981039346656037ULL;
+	char buffer[4096];
+	while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+		for (streamsize i = 0; i < in.gcount(); i++) {
+			hash ^= static_cast<unsigned char>(buffer[i]);
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+BacktestCheckpoint::BacktestCheckpoint(const string &filename, const string &key, size_t positions, bool resume)
+	: filename_(filename), key_(key), positions_(positions) {
+	ifstream in;
+	if (resume)
+		in.open(filename.c_str(), ios::in | ios::binary);
+	if (in.is_open()) {
+		char magic[4];
+		uint32_t version = 0, keyLength = 0, count = 0;
+		if (!in.read(magic, 4) || !equal(magic, magic + 4, checkpointMagic) || !readValue(in, version)
+			|| version != checkpointVersion || !readValue(in, keyLength))
+			throw runtime_error(filename + " is not a backtest checkpoint");
+		string fileKey(keyLength, ' ');
+		if (keyLength > 0 && !in.read(&fileKey[0], keyLength))
+			throw runtime_error(filename + " is not a backtest checkpoint");
+		if (fileKey != key || !readValue(in, count) || count != positions)
+			throw runtime_error(filename + " was written by another run: " + fileKey);
+
+		// whole records only, a crash in the middle of one leaves a shorter tail
+		while (true) {
+			CheckpointRecord record;
+			char date[8];
+			double values[recordDoubles];
+			record.positions.resize(3 * positions);
+			if (!in.read(date, 8) || !in.read(reinterpret_cast<char *>(values), sizeof(values))
+				|| (positions > 0 && !in.read(reinterpret_cast<char *>(&record.positions[0]),
+					record.positions.size() * sizeof(double))))
+				break;
+			record.date.assign(date, 8);
+			record.a = values[0];
+			record.sigma = values[1];
+			record.swapValue = values[2];
+			record.swaptionValue = values[3];
+			record.value = values[4];
+			record.delta = values[5];
+			record.vega = values[6];
+			record.pnl = values[7];
+			record.cumulativePnL = values[8];
+			completed_.push_back(record);
+		}
+		in.close();
+	}
+
+	rewrite(); // without the torn tail, then appended to
+}
+
+void BacktestCheckpoint::rewrite() {
+	if (file_.is_open())
+		file_.close();
+	file_.open(filename_.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!file_.is_open())
+		throw runtime_error("cannot write checkpoint " + filename_);
+	writeHeader();
+	for (size_t k = 0; k < completed_.size(); k++)
+		writeRecord(completed_[k]);
+	file_.flush();
+}
+
+void BacktestCheckpoint::writeHeader() {
+	file_.write(checkpointMagic, 4);
+	writeValue(file_, checkpointVersion);
+	writeValue(file_, uint32_t(key_.size()));
+	file_.write(key_.data(), key_.size());
+	writeValue(file_, uint32_t(positions_));
+}
+
+void BacktestCheckpoint::writeRecord(const CheckpointRecord &record) {
+	if (record.date.size() != 8 || record.positions.size() != 3 * positions_)
+		throw runtime_error("bad checkpoint record for " + record.date);
+	double values[recordDoubles] = { record.a, record.sigma, record.swapValue, record.swaptionValue,
+		record.value, record.delta, record.vega, record.pnl, record.cumulativePnL };
+	file_.write(record.date.data(), 8);
+	file_.write(reinterpret_cast<const char *>(values), sizeof(values));
+	if (positions_ > 0)
+		file_.write(reinterpret_cast<const char *>(&record.positions[0]), record.positions.size() * sizeof(double));
+}
+
+void BacktestCheckpoint::append(const CheckpointRecord &record) {
+	writeRecord(record);
+	file_.flush(); // in the operating system once the date is done, a crash of the program cannot lose it
+	if (!file_)
+		throw runtime_error("cannot write checkpoint " + filename_);
+	completed_.push_back(record);
+}
@@ -0,0 +1,55 @@
+#ifndef     _CHECKPOINT_HPP_
+# define    _CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// This file and Checkpoint.cpp keep the completed dates of a backtest in a small binary file next to its output,
+// one fixed size record per date appended and flushed as soon as the date is written, so a run that crashed or
+// was stopped can be resumed after its last completed date instead of from the start of the history. A record
+// torn by the crash is dropped on resume. //
+
+// File layout: "SWCK", version, length and bytes of the run key, number of positions, then per date:
+// yyyymmdd, a, sigma, swap value, swaption value, value, delta, vega, PnL, cumulative PnL,
+// then value, delta and vega of every position, all doubles
+
+struct CheckpointRecord {
+	std::string date; // like "20080701"
+	double a;
+	double sigma;
+	double swapValue;
+	double swaptionValue;
+	double value;
+	double delta;
+	double vega;
+	double pnl;
+	double cumulativePnL;
+	std::vector<double> positions; // value, delta and vega of every position
+};
+
+// 64 bit FNV-1a hash of the bytes of a file, for keys that change with the contents of an input
+std::uint64_t fileHash(const std::string &filename);
+
+class BacktestCheckpoint {
+public:
+	// the key names the run (portfolio contents, first date), a file written for another key is not resumed.
+	// Without resume, or without a file, the checkpoint starts empty
+	BacktestCheckpoint(const std::string &filename, const std::string &key, std::size_t positions, bool resume);
+
+	const std::vector<CheckpointRecord> &completed() const { return completed_; }
+	void append(const CheckpointRecord &record);
+
+private:
+	void rewrite();
+	void writeHeader();
+	void writeRecord(const CheckpointRecord &record);
+	std::string filename_;
+	std::string key_;
+	std::size_t positions_;
+	std::vector<CheckpointRecord> completed_;
+	std::ofstream file_;
+};
+
+#endif /*!_CHECKPOINT_HPP_*/
@@ -0,0 +1,53 @@
+#include "Counters.hpp"
+#include "Arena.hpp"
+
+using namespace std;
+
+CounterRegistry &CounterRegistry::instance() {
+	static CounterRegistry registry;
+	return registry;
+}
+
+atomic<size_t> &CounterRegistry::counter(const string &name) {
+	lock_guard<mutex> lock(mutex_);
+	for (size_t k = 0; k < names_.size(); k++)
+		if (names_[k] == name)
+			return counters_[k];
+	HeapScope heap; // the registry outlives any arena
+	names_.push_back(name);
+	counters_.emplace_back(0);
+	return counters_.back();
+}
+
+void CounterRegistry::set(const string &name, size_t value) {
+	counter(name).store(value, memory_order_relaxed);
+}
+
+void CounterRegistry::snapshot(const string &label) {
+	lock_guard<mutex> lock(mutex_);
+	HeapScope heap;
+	vector<size_t> values;
+	for (size_t k = 0; k < counters_.size(); k++)
+		values.push_back(counters_[k].load(memory_order_relaxed));
+	labels_.push_back(label);
+	snapshots_.push_back(values);
+}
+
+void CounterRegistry::write(ostream &out) const {
+	lock_guard<mutex> lock(mutex_);
+	out << "Snapshot";
+	for (size_t k = 0; k < names_.size(); k++)
+		out << "," << names_[k];
+	out << endl;
+	// counters registered after a snapshot were zero at that time
+	vector<size_t> last(names_.size(), 0);
+	for (size_t s = 0; s < snapshots_.size(); s++) {
+		out << labels_[s];
+		for (size_t k = 0; k < names_.size(); k++) {
+			size_t value = k < snapshots_[s].size() ? snapshots_[s][k] : 0;
+			out << "," << value - last[k];
+			last[k] = value;
+		}
+		out << endl;
+	}
+}
@@ -0,0 +1,47 @@
+#ifndef     _COUNTERS_HPP_
+# define    _COUNTERS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// This file and Counters.cpp keep named event counters (engine calculations, notifications, solver
+// iterations, ...). COUNT(name, n) costs one relaxed atomic add, the counter is looked up once per call
+// site. Building with DISABLE_COUNTERS defined compiles every COUNT away. //
+
+class CounterRegistry {
+public:
+	static CounterRegistry &instance();
+
+	std::atomic<std::size_t> &counter(const std::string &name); // registered on first use
+	void set(const std::string &name, std::size_t value); // for totals kept elsewhere, like heap allocations
+
+	// record the current value of every counter, the CSV shows the change since the previous snapshot
+	void snapshot(const std::string &label);
+	void write(std::ostream &out) const;
+
+private:
+	CounterRegistry() {}
+	mutable std::mutex mutex_;
+	std::deque<std::atomic<std::size_t> > counters_; // deque, so references stay valid as it grows
+	std::vector<std::string> names_;
+	std::vector<std::string> labels_;
+	std::vector<std::vector<std::size_t> > snapshots_;
+};
+
+#ifndef DISABLE_COUNTERS
+# define COUNT(name, n) do { \
+	static std::atomic<std::size_t> &counter_ = CounterRegistry::instance().counter(name); \
+	counter_.fetch_add(n, std::memory_order_relaxed); \
+} while (0)
+# define COUNTER_SET(name, value) CounterRegistry::instance().set(name, value)
+#else
+# define COUNT(name, n) do {} while (0)
+# define COUNTER_SET(name, value) do {} while (0)
+#endif
+
+#endif /*!_COUNTERS_HPP_*/
@@ -0,0 +1,52 @@
+#ifndef     _COUNTINGENGINE_HPP_
+# define    _COUNTINGENGINE_HPP_
+
+#include <ql/quantlib.hpp>
+#include "Counters.hpp"
+
+// wraps a pricing engine and counts its calculate() calls under the given counter name. Instruments and
+// helpers talk to the wrapped engine through the arguments and results it hands out, and are notified
+// whenever it is (e.g. when the model of a swaption engine is recalibrated).
+class CountingEngine : public QuantLib::PricingEngine, public QuantLib::Observer {
+public:
+	CountingEngine(const boost::shared_ptr<QuantLib::PricingEngine> &engine, const std::string &name)
+		: engine_(engine), counter_(CounterRegistry::instance().counter(name)) {
+		registerWith(engine_);
+	}
+	QuantLib::PricingEngine::arguments *getArguments() const { return engine_->getArguments(); }
+	const QuantLib::PricingEngine::results *getResults() const { return engine_->getResults(); }
+	void reset() { engine_->reset(); }
+	void calculate() const {
+		counter_.fetch_add(1, std::memory_order_relaxed);
+		engine_->calculate();
+	}
+	void update() { notifyObservers(); }
+
+private:
+	boost::shared_ptr<QuantLib::PricingEngine> engine_;
+	std::atomic<std::size_t> &counter_;
+};
+
+// the engine in a CountingEngine, or the engine itself when built with DISABLE_COUNTERS, so that the
+// instruments call it directly and nothing is left of the counting
+inline boost::shared_ptr<QuantLib::PricingEngine> countingEngine(
+	const boost::shared_ptr<QuantLib::PricingEngine> &engine, const std::string &name) {
+#ifndef DISABLE_COUNTERS
+	return boost::shared_ptr<QuantLib::PricingEngine>(new CountingEngine(engine, name));
+#else
+	return engine;
+#endif
+}
+
+// counts the notifications sent by the observables it is registered with, a calibrated model sends one
+// per function evaluation of the optimizer
+class NotificationCounter : public QuantLib::Observer {
+public:
+	NotificationCounter() : count_(0) {}
+	void update() { count_++; }
+	QuantLib::Size count() const { return count_; }
+private:
+	QuantLib::Size count_;
+};
+
+#endif /*!_COUNTINGENGINE_HPP_*/
@@ -0,0 +1,36 @@
+#include "FastG2SwaptionEngine.hpp"
+#include "Counters.hpp"
+
+using namespace QuantLib;
+
+FastG2SwaptionEngine::FastG2SwaptionEngine(const boost::shared_ptr<G2> &model, Size nodes)
+	: GenericModelEngine<G2, Swaption::arguments, Swaption::results>(model), rule_(gaussHermiteRule(nodes)) {}
+
+void FastG2SwaptionEngine::calculate() const {
+	QL_REQUIRE(arguments_.settlementType == Settlement::Physical, "cash-settled swaptions not priced with G2 engine");
+	QL_REQUIRE(arguments_.exercise->type() == Exercise::European, "cannot use on exercise other than European");
+	QL_REQUIRE(arguments_.spread == 0.0, "non zero spread (" << arguments_.spread << ") not allowed");
+	COUNT("fast g2 swaption prices", 1);
+
+	// the swap in the times of the model's curve, as G2::swaption sees it
+	const Handle<YieldTermStructure> &termStructure = model_->termStructure();
+	Date settlement = termStructure->referenceDate();
+	DayCounter dayCounter = termStructure->dayCounter();
+	G2Swaption swaption;
+	swaption.expiry = dayCounter.yearFraction(settlement, arguments_.floatingResetDates[0]);
+	swaption.expiryDiscount = termStructure->discount(swaption.expiry);
+	swaption.payer = (arguments_.type == VanillaSwap::Payer);
+	Time last = swaption.expiry;
+	for (Size i = 0; i < arguments_.fixedPayDates.size(); i++) {
+		Time t = dayCounter.yearFraction(settlement, arguments_.fixedPayDates[i]);
+		swaption.payTimes.push_back(t);
+		swaption.coupons.push_back(arguments_.fixedRate * (t - last));
+		swaption.payDiscounts.push_back(termStructure->discount(t));
+		last = t;
+	}
+	swaption.coupons.back() += 1.0;
+
+	Array p = model_->params(); // a, sigma, b, eta, rho
+	G2Params params = { p[0], p[1], p[2], p[3], p[4] };
+	results_.value = arguments_.nominal * g2SwaptionValue(swaption, params, rule_);
+}
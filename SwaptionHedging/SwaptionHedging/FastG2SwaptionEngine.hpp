@@ -0,0 +1,21 @@
+#ifndef     _FASTG2SWAPTIONENGINE_HPP_
+# define    _FASTG2SWAPTIONENGINE_HPP_
+
+#include <ql/quantlib.hpp>
+#include "G2Analytics.hpp"
+
+// This file and FastG2SwaptionEngine.cpp plug G2Analytics into QuantLib as a swaption engine for the G2 model.
+// It takes the same inputs as G2SwaptionEngine (accruals from the curve's times) so it can replace it in
+// calibration and pricing; the Gauss-Hermite rule is built once with the engine. //
+
+class FastG2SwaptionEngine : public QuantLib::GenericModelEngine<QuantLib::G2,
+	QuantLib::Swaption::arguments, QuantLib::Swaption::results> {
+public:
+	FastG2SwaptionEngine(const boost::shared_ptr<QuantLib::G2> &model, QuantLib::Size nodes = 32);
+	void calculate() const;
+
+private:
+	GaussHermiteRule rule_;
+};
+
+#endif /*!_FASTG2SWAPTIONENGINE_HPP_*/
@@ -0,0 +1,77 @@
+#include "G2Analytics.hpp"
+#include "HullWhiteAnalytics.hpp"
+#include <cmath>
+
+double g2IntegratedVariance(const G2Params &p, double t) {
+	double a = p.a, b = p.b;
+	double ea = std::exp(-a * t), eb = std::exp(-b * t), eab = std::exp(-(a + b) * t);
+	return p.sigma * p.sigma / (a * a) * (t + 2.0 / a * ea - 0.5 / a * ea * ea - 1.5 / a)
+		+ p.eta * p.eta / (b * b) * (t + 2.0 / b * eb - 0.5 / b * eb * eb - 1.5 / b)
+		+ 2.0 * p.rho * p.sigma * p.eta / (a * b) * (t + (ea - 1.0) / a + (eb - 1.0) / b - (eab - 1.0) / (a + b));
+}
+
+double g2SwaptionValue(const G2Swaption &swaption, const G2Params &p, const GaussHermiteRule &rule) {
+	double a = p.a, b = p.b, sigma = p.sigma, eta = p.eta, rho = p.rho;
+	double T = swaption.expiry;
+	double w = swaption.payer ? 1.0 : -1.0;
+	std::size_t n = swaption.coupons.size();
+
+	// moments of the two factors at the expiry in the expiry forward measure
+	double sigmax = sigma * std::sqrt(0.5 * (1.0 - std::exp(-2.0 * a * T)) / a);
+	double sigmay = eta * std::sqrt(0.5 * (1.0 - std::exp(-2.0 * b * T)) / b);
+	double rhoxy = rho * eta * sigma * (1.0 - std::exp(-(a + b) * T)) / ((a + b) * sigmax * sigmay);
+	double temp = sigma * sigma / (a * a);
+	double mux = -((temp + rho * sigma * eta / (a * b)) * (1.0 - std::exp(-a * T))
+		- 0.5 * temp * (1.0 - std::exp(-2.0 * a * T))
+		- rho * sigma * eta / (b * (a + b)) * (1.0 - std::exp(-(a + b) * T)));
+	temp = eta * eta / (b * b);
+	double muy = -((temp + rho * sigma * eta / (a * b)) * (1.0 - std::exp(-b * T))
+		- 0.5 * temp * (1.0 - std::exp(-2.0 * b * T))
+		- rho * sigma * eta / (a * (a + b)) * (1.0 - std::exp(-(a + b) * T)));
+	double txy = std::sqrt(1.0 - rhoxy * rhoxy);
+
+	// bond coefficients P(T, t_i) = A_i exp(-Ba_i x - Bb_i y), shared by every node
+	double VT = g2IntegratedVariance(p, T);
+	std::vector<double> cA(n), Ba(n), Bb(n), lambda(n);
+	for (std::size_t i = 0; i < n; i++) {
+		double tau = swaption.payTimes[i] - T;
+		double A = swaption.payDiscounts[i] / swaption.expiryDiscount
+			* std::exp(0.5 * (g2IntegratedVariance(p, tau) - g2IntegratedVariance(p, swaption.payTimes[i]) + VT));
+		cA[i] = swaption.coupons[i] * A;
+		Ba[i] = (1.0 - std::exp(-a * tau)) / a;
+		Bb[i] = (1.0 - std::exp(-b * tau)) / b;
+	}
+
+	double value = 0.0;
+	double y = 0.0; // critical y of the previous node, a good start for the next one
+	for (std::size_t k = 0; k < rule.nodes.size(); k++) {
+		double x = mux + sigmax * rule.nodes[k];
+		for (std::size_t i = 0; i < n; i++)
+			lambda[i] = cA[i] * std::exp(-Ba[i] * x);
+
+		// the coupon bond is worth par at y: 1 - sum lambda_i exp(-Bb_i y) is increasing and concave,
+		// so Newton steps land left of the root and then climb to it
+		for (int iteration = 0; iteration < 100; iteration++) {
+			double f = 1.0, df = 0.0;
+			for (std::size_t i = 0; i < n; i++) {
+				double l = lambda[i] * std::exp(-Bb[i] * y);
+				f -= l;
+				df += Bb[i] * l;
+			}
+			double step = f / df;
+			y -= step;
+			if (std::fabs(step) < 1.0e-12)
+				break;
+		}
+
+		double h1 = (y - muy) / (sigmay * txy) - rhoxy * (x - mux) / (sigmax * txy);
+		double v = normalCdf(-w * h1);
+		for (std::size_t i = 0; i < n; i++) {
+			double h2 = h1 + Bb[i] * sigmay * txy;
+			double kappa = -Bb[i] * (muy - 0.5 * txy * txy * sigmay * sigmay * Bb[i] + rhoxy * sigmay * (x - mux) / sigmax);
+			v -= lambda[i] * std::exp(kappa) * normalCdf(-w * h2);
+		}
+		value += rule.weights[k] * v;
+	}
+	return w * swaption.expiryDiscount * value;
+}
@@ -0,0 +1,36 @@
+#ifndef     _G2ANALYTICS_HPP_
+# define    _G2ANALYTICS_HPP_
+
+#include "GaussHermite.hpp"
+#include <vector>
+
+// This file and G2Analytics.cpp price European swaptions in the two factor G2++ model (Brigo-Mercurio 4.2)
+// with no QuantLib objects. The price is the expectation over the first factor at expiry, taken with a fixed
+// Gauss-Hermite rule, of a closed form in the second factor; QuantLib's G2::swaption takes the same
+// expectation with a segment integral. Everything that depends on the curve only is kept with the swaption
+// so a calibration reprices it for new parameters without touching the curve. //
+
+struct G2Params {
+	double a;
+	double sigma;
+	double b;
+	double eta;
+	double rho;
+};
+
+// a European swaption on a unit notional swap starting at the expiry
+struct G2Swaption {
+	double expiry;
+	std::vector<double> payTimes; // fixed leg payment times
+	std::vector<double> coupons; // strike * accrual, the last one includes the notional
+	double expiryDiscount; // P(0, expiry)
+	std::vector<double> payDiscounts; // P(0, payTimes[i])
+	bool payer;
+};
+
+// V(t) of Brigo-Mercurio 4.10, the variance of the integrated short rate over [0, t]
+double g2IntegratedVariance(const G2Params &p, double t);
+
+double g2SwaptionValue(const G2Swaption &swaption, const G2Params &p, const GaussHermiteRule &rule);
+
+#endif /*!_G2ANALYTICS_HPP_*/
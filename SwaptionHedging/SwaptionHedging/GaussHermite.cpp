@@ -0,0 +1,53 @@
+#include "GaussHermite.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// roots of the Hermite polynomial by Newton from the usual asymptotic guesses (Numerical Recipes gauher),
+// for the weight exp(-x*x), then scaled to the standard normal density
+GaussHermiteRule gaussHermiteRule(std::size_t n) {
+	if (n == 0)
+		throw std::invalid_argument("a Gauss-Hermite rule needs at least one node");
+	const double pim4 = 0.7511255444649425; // pi^(-1/4)
+	std::vector<double> x(n), w(n);
+	double z = 0.0;
+	for (std::size_t i = 0; i < (n + 1) / 2; i++) {
+		if (i == 0)
+			z = std::sqrt(2.0 * n + 1.0) - 1.85575 * std::pow(2.0 * n + 1.0, -0.16667);
+		else if (i == 1)
+			z -= 1.14 * std::pow(double(n), 0.426) / z;
+		else if (i == 2)
+			z = 1.86 * z - 0.86 * x[0];
+		else if (i == 3)
+			z = 1.91 * z - 0.91 * x[1];
+		else
+			z = 2.0 * z - x[i - 2];
+		double pp = 0.0;
+		for (int iteration = 0; iteration < 100; iteration++) {
+			// normalized Hermite recurrence up to degree n at z
+			double p1 = pim4, p2 = 0.0;
+			for (std::size_t j = 0; j < n; j++) {
+				double p3 = p2;
+				p2 = p1;
+				p1 = z * std::sqrt(2.0 / (j + 1)) * p2 - std::sqrt(double(j) / (j + 1)) * p3;
+			}
+			pp = std::sqrt(2.0 * n) * p2;
+			double step = p1 / pp;
+			z -= step;
+			if (std::fabs(step) <= 1.0e-15 * std::max(1.0, std::fabs(z)))
+				break;
+		}
+		x[i] = z;
+		x[n - 1 - i] = -z;
+		w[i] = w[n - 1 - i] = 2.0 / (pp * pp);
+	}
+
+	// x = z / sqrt(2) and the weights divided by sqrt(pi) for the standard normal
+	GaussHermiteRule rule;
+	const double sqrtPi = 1.7724538509055160273;
+	for (std::size_t i = 0; i < n; i++) {
+		rule.nodes.push_back(std::sqrt(2.0) * x[n - 1 - i]); // ascending
+		rule.weights.push_back(w[n - 1 - i] / sqrtPi);
+	}
+	return rule;
+}
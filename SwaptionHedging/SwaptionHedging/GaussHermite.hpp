@@ -0,0 +1,18 @@
+#ifndef     _GAUSSHERMITE_HPP_
+# define    _GAUSSHERMITE_HPP_
+
+#include <cstddef>
+#include <vector>
+
+// This file and GaussHermite.cpp compute Gauss-Hermite quadrature rules once, so that the expectation of a
+// payoff over a Gaussian factor is a fixed weighted sum that can be shared by every swaption of an expiry. //
+
+// E[f(Z)] for a standard normal Z is sum over k of weights[k] * f(nodes[k])
+struct GaussHermiteRule {
+	std::vector<double> nodes;
+	std::vector<double> weights; // sum to 1
+};
+
+GaussHermiteRule gaussHermiteRule(std::size_t n);
+
+#endif /*!_GAUSSHERMITE_HPP_*/
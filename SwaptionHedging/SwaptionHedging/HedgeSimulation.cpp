@@ -0,0 +1,89 @@
+#include "HedgeSimulation.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// model delta: sensitivity of the swaption to the short rate over that of the underlying swap
+static double hedgeRatio(const HullWhiteSwaption &swaption, const BondCoefficients &coeffs, double r) {
+	const double h = 1.0e-5;
+	double dV = hwSwaptionValue(swaption, coeffs, r + h) - hwSwaptionValue(swaption, coeffs, r - h);
+	double dS = hwSwapValue(swaption, coeffs, r + h) - hwSwapValue(swaption, coeffs, r - h);
+	return dS != 0.0 ? dV / dS : 0.0;
+}
+
+std::vector<double> simulateHedgingErrors(const HedgeSimulationSetup &setup) {
+	const HullWhiteSwaption &swaption = setup.swaption;
+	double a = swaption.a, sigma = swaption.sigma;
+	std::size_t steps = setup.times.size() - 1;
+
+	// exact joint transition of the OU factor x and its integral over every rehedge step
+	std::vector<HullWhiteStep> step(steps);
+	for (std::size_t k = 0; k < steps; k++)
+		step[k] = hwExactStep(a, sigma, setup.times[k + 1] - setup.times[k]);
+
+	// value and hedge ratio today are the same for every path
+	double r0 = setup.alpha[0];
+	double V0 = hwSwaptionValue(swaption, setup.coeffs[0], r0);
+	double delta0 = hedgeRatio(swaption, setup.coeffs[0], r0);
+	double cash0 = V0 - delta0 * hwSwapValue(swaption, setup.coeffs[0], r0);
+
+	std::vector<double> errors(setup.paths);
+	std::size_t blocks = (setup.paths + setup.blockSize - 1) / setup.blockSize;
+	parallelFor(blocks, setup.threads, [&](std::size_t b) {
+		// one random stream per block, results do not depend on the number of threads
+		std::mt19937_64 rng(setup.seed + 1000003UL * b);
+		std::normal_distribution<double> gauss;
+		std::size_t last = std::min(setup.paths, (b + 1) * setup.blockSize);
+		for (std::size_t p = b * setup.blockSize; p < last; p++) {
+			double x = 0.0, r = r0, delta = delta0, cash = cash0, swap = 0.0;
+			for (std::size_t k = 0; k < steps; k++) {
+				double z1 = gauss(rng), z2 = gauss(rng);
+				const HullWhiteStep &s = step[k];
+				double y = x * s.mean + s.sdY * (s.rho * z1 + std::sqrt(1.0 - s.rho * s.rho) * z2);
+				x = x * s.decay + s.sdX * z1;
+				cash *= std::exp(setup.alphaIntegral[k] + y); // money market account
+				r = x + setup.alpha[k + 1];
+				swap = hwSwapValue(swaption, setup.coeffs[k + 1], r);
+				if (k + 1 < steps) { // rehedge, the new swap position is paid from the cash account
+					double newDelta = hedgeRatio(swaption, setup.coeffs[k + 1], r);
+					cash -= (newDelta - delta) * swap;
+					delta = newDelta;
+				}
+			}
+			double option = hwSwaptionValue(swaption, setup.coeffs[steps], r);
+			errors[p] = setup.notional * (delta * swap + cash - option);
+		}
+	});
+	return errors;
+}
+
+static double percentile(const std::vector<double> &sorted, double q) {
+	double pos = q * (sorted.size() - 1);
+	std::size_t i = static_cast<std::size_t>(pos);
+	if (i + 1 >= sorted.size())
+		return sorted.back();
+	return sorted[i] + (pos - i) * (sorted[i + 1] - sorted[i]);
+}
+
+HedgeSimulationStats hedgingErrorStats(const HedgeSimulationSetup &setup, std::vector<double> errors) {
+	HedgeSimulationStats stats;
+	stats.optionValue = setup.notional * hwSwaptionValue(setup.swaption, setup.coeffs[0], setup.alpha[0]);
+	double sum = 0.0, sum2 = 0.0;
+	for (std::size_t i = 0; i < errors.size(); i++) {
+		sum += errors[i];
+		sum2 += errors[i] * errors[i];
+	}
+	double n = static_cast<double>(errors.size());
+	stats.mean = sum / n;
+	stats.stdDev = n > 1 ? std::sqrt(std::max(0.0, (sum2 - n * stats.mean * stats.mean) / (n - 1))) : 0.0;
+	std::sort(errors.begin(), errors.end());
+	stats.min = errors.front();
+	stats.max = errors.back();
+	stats.percentile1 = percentile(errors, 0.01);
+	stats.percentile5 = percentile(errors, 0.05);
+	stats.median = percentile(errors, 0.5);
+	stats.percentile95 = percentile(errors, 0.95);
+	stats.percentile99 = percentile(errors, 0.99);
+	return stats;
+}
@@ -0,0 +1,42 @@
+#ifndef     _HEDGESIMULATION_HPP_
+# define    _HEDGESIMULATION_HPP_
+
+#include "HullWhiteAnalytics.hpp"
+#include <vector>
+
+// This file and HedgeSimulation.cpp simulate short rate paths of the calibrated Hull-White model and
+// delta-hedge a short swaption with its underlying swap along every path. //
+
+// the rehedge grid and everything on it that does not depend on the path
+struct HedgeSimulationSetup {
+	HullWhiteSwaption swaption;
+	std::vector<double> times; // rehedge times, times[0] = 0 and times.back() = horizon
+	std::vector<double> alpha; // r(t) = x(t) + alpha(t), x is the zero mean OU factor
+	std::vector<double> alphaIntegral; // integral of alpha over [times[k], times[k+1]]
+	std::vector<BondCoefficients> coeffs; // bond coefficients seen from every rehedge time
+	double notional;
+	std::size_t paths;
+	std::size_t blockSize; // paths per block, every block has its own random stream
+	unsigned long seed;
+	unsigned int threads;
+};
+
+struct HedgeSimulationStats {
+	double optionValue; // value of the swaption today
+	double mean;
+	double stdDev;
+	double min;
+	double max;
+	double percentile1;
+	double percentile5;
+	double median;
+	double percentile95;
+	double percentile99;
+};
+
+// hedging error of every path: hedge portfolio minus swaption value at the horizon
+std::vector<double> simulateHedgingErrors(const HedgeSimulationSetup &setup);
+
+HedgeSimulationStats hedgingErrorStats(const HedgeSimulationSetup &setup, std::vector<double> errors);
+
+#endif /*!_HEDGESIMULATION_HPP_*/
@@ -22,14 +22,33 @@
 #include <ql/time/daycounters/thirty360.hpp>
 #include <ql/utilities/dataformatters.hpp>
 #include "CSVparser.hpp"
+#include "Portfolio.hpp"
+#include "HedgeSimulation.hpp"
+#include "BermudanLSM.hpp"
+#include "HullWhiteLattice.hpp"
+#include "BatchedFdHullWhite.hpp"
+#include "ParallelFor.hpp"
+#include "Market.hpp"
+#include "LatencyHistogram.hpp"
+#include "PricingDaemon.hpp"
+#include "AllocationCounter.hpp"
+#include "Arena.hpp"
+#include "StageTimer.hpp"
+#include "Counters.hpp"
+#include "MarketData.hpp"
+#include "ScenarioEngine.hpp"
+#include "FastG2SwaptionEngine.hpp"
+#include "Pipeline.hpp"
+#include "Checkpoint.hpp"
 
 #include <fstream> 
 #include <string>
 #include <iostream>
 #include <streambuf> 
-#include <boost/timer.hpp>
-#include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <thread>
 
 using namespace QuantLib;
 using namespace std;
@@ -42,225 +61,902 @@ namespace QuantLib {
 }
 #endif
 
-/* This file is used to calculate daily swaption and underying swap price, and delta value used for heding. */
-
-// read discount factors from files like "DF_20080701.csv"
-vector <double> DiscountFactorVec(const string &filename) {
-	Parser data = Parser(filename); // from CSVParser
-	vector <double> result;
-	result.push_back(1.0); // QuantLib requires the first discount factor must be 1.0
-	for (int i = 0; i < data.rowCount(); i++)
-	result.push_back(stod(data[i]["Discount"])); 
-	return result;
-} 
-
-// read implied volatilities surface from files like "IV_20080701.csv"
-vector <double> ImpliedVolatilityVec(const string &filename) {
-	Parser data = Parser(filename);
-	vector <double> result;
-	// considering the liquitity, only use swaptions with 1-10 Yr maturities and tenors
-	for (int i = 4; i <= 13; i++) {
-		for (int j = 1; j <= 10; j++)
-			result.push_back(stod(data[i][j])/100);
+/* This file is used to calculate daily value, delta and vega of a portfolio of swaptions and hedge swaps (Portfolio.csv).
+   Curve, Hull-White model and instruments are built once; every date only updates their quotes and recalibrates. */
+
+// bond coefficients P(t,T) = A*exp(-B*r) of the swap start and payment times, from the model's analytic discountBond
+BondCoefficients bondCoefficients(const HullWhite &model, Time t, Time start, const vector<Time> &payTimes) {
+	BondCoefficients c;
+	c.t = t;
+	vector<Time> maturities(1, start);
+	maturities.insert(maturities.end(), payTimes.begin(), payTimes.end());
+	for (Size i = 0; i < maturities.size(); i++) {
+		Real A = model.discountBond(t, maturities[i], 0.0);
+		c.A.push_back(A);
+		c.B.push_back(-std::log(model.discountBond(t, maturities[i], 1.0) / A));
 	}
-	return result;
-} 
+	return c;
+}
 
-// used for returning two values from "calculate" function
-struct Result {
-	double swapNPV;
-	double swaptionNPV;
-};
+// r(t) = x(t) + alpha(t) on a time grid, and the integral of alpha over every step of it
+void shortRateDrift(Real a, Real sigma, const Handle<YieldTermStructure> &termStructure, const vector<Time> &times,
+	vector<Real> &alpha, vector<Real> &alphaIntegral) {
+	for (Size k = 0; k < times.size(); k++) {
+		Time t = times[k];
+		Rate forward = termStructure->forwardRate(t, t, Continuous, NoFrequency, true);
+		Real temp = sigma * (1.0 - std::exp(-a * t)) / a;
+		alpha.push_back(forward + 0.5 * temp * temp);
+		if (k > 0) {
+			Time t0 = times[k - 1];
+			Real convexity = sigma * sigma / (2.0 * a * a) * ((t - t0)
+				- 2.0 * (std::exp(-a * t0) - std::exp(-a * t)) / a
+				+ (std::exp(-2.0 * a * t0) - std::exp(-2.0 * a * t)) / (2.0 * a));
+			alphaIntegral.push_back(-std::log(termStructure->discount(t) / termStructure->discount(t0)) + convexity);
+		}
+	}
+}
 
-// calculating swaption price and underying swap value
-Result calculate(const string &dateString, Date todaysDate) {
-	//Number of swaptions to be calibrated to...
-	Size numRows = 10;
-	Size numCols = 10;
-	Integer swapLengths[] = { 1,2,3,4,5,6,7,8,9,10 }; // tenor
-
-	// construct strings like "DF_20080701.csv"
-	string DFString = "DF_";
-	DFString += dateString;
-	DFString += ".csv";
-	string IVString = "IV_";
-	IVString += dateString;
-	IVString += ".csv";
-
-	vector < DiscountFactor > dfs = DiscountFactorVec(DFString); // Discount Factor
-	vector < Volatility > swaptionVols = ImpliedVolatilityVec(IVString);
-
-	Calendar calendar = TARGET();
-	Settings::instance().evaluationDate() = todaysDate;
-
-	std::vector <Date > dates; // Dates of each discount factor point
-
-	Calendar cal = TARGET();
-	EURLibor1M libor;
-	DayCounter dc = libor.dayCounter();
-
-	dates.push_back(todaysDate); dates.push_back(todaysDate + 3 * Months);
-	dates.push_back(todaysDate + 5 * Months); dates.push_back(todaysDate + 8 * Months);
-	dates.push_back(todaysDate + 11 * Months); dates.push_back(todaysDate + 14 * Months);
-	dates.push_back(todaysDate + 17 * Months); dates.push_back(todaysDate + 20 * Months);
-	dates.push_back(todaysDate + 2 * Years); dates.push_back(todaysDate + 3 * Years);
-	dates.push_back(todaysDate + 4 * Years); dates.push_back(todaysDate + 5 * Years);
-	dates.push_back(todaysDate + 6 * Years); dates.push_back(todaysDate + 7 * Years);
-	dates.push_back(todaysDate + 8 * Years); dates.push_back(todaysDate + 9 * Years);
-	dates.push_back(todaysDate + 10 * Years); dates.push_back(todaysDate + 11 * Years);
-	dates.push_back(todaysDate + 12 * Years); dates.push_back(todaysDate + 15 * Years);
-	dates.push_back(todaysDate + 20 * Years); dates.push_back(todaysDate + 25 * Years);
-	dates.push_back(todaysDate + 30 * Years); dates.push_back(todaysDate + 40 * Years);
-	dates.push_back(todaysDate + 50 * Years);
-
-	// build yield curve
-	Handle<YieldTermStructure> rhTermStructure(
-		boost::shared_ptr<InterpolatedDiscountCurve<Linear> >(
-			new InterpolatedDiscountCurve < Linear >(dates, dfs, dc, cal)));
-
-	// Define properties of swap/swaption
-	Frequency fixedLegFrequency = Semiannual;
-	BusinessDayConvention fixedLegConvention = Unadjusted;
-	BusinessDayConvention floatingLegConvention = ModifiedFollowing;
-	DayCounter fixedLegDayCounter = Thirty360(Thirty360::European);
-	Frequency floatingLegFrequency = Quarterly;
-	VanillaSwap::Type type = VanillaSwap::Payer;
-	boost::shared_ptr<IborIndex> indexThreeMonths(new
-		Euribor3M(rhTermStructure));
-
-	// defining the swaptions to be used in model calibration
-	std::vector<Period> swaptionMaturities;
-	for (int i = 1; i <= 10; i++) {
-		swaptionMaturities.push_back(Period(i, Years)); // swaption maturity
+// usage: SwaptionHedging --simulate [date] [paths] [rehedge days] [horizon days] [threads] [portfolio.csv]
+// delta-hedge the first swaption of the portfolio along simulated Hull-White paths
+int simulate(int argc, char *argv[]) {
+	string dateString = (argc > 1) ? argv[1] : "20080701";
+	Size paths = (argc > 2) ? stoi(argv[2]) : 10000;
+	Integer rehedgeDays = (argc > 3) ? stoi(argv[3]) : 1;
+	Integer horizonDays = (argc > 4) ? stoi(argv[4]) : 183;
+	unsigned int threads = (argc > 5) ? stoi(argv[5]) : defaultThreadCount();
+	string portfolioFile = (argc > 6) ? argv[6] : "Portfolio.csv";
+
+	vector<Position> positions = readPortfolio(portfolioFile);
+	Size n = 0;
+	while (n < positions.size() && !positions[n].isSwaption)
+		n++;
+	QL_REQUIRE(n < positions.size(), "no swaption in " << portfolioFile);
+	const Position &p = positions[n];
+
+	Date todaysDate = stringToDate(dateString);
+	Market market(todaysDate, DiscountFactorVec("DF_" + dateString + ".csv"),
+		ImpliedVolatilityVec("IV_" + dateString + ".csv"));
+	const HullWhite &model = *market.model();
+	Handle<YieldTermStructure> termStructure = market.termStructure();
+	Real a = model.params()[0], sigma = model.params()[1];
+	cout << "calibrated to: a = " << a << ", sigma = " << sigma << endl;
+
+	// the swaption on a unit notional, in the model's time measure
+	HedgeSimulationSetup setup;
+	boost::shared_ptr<const CachedSchedule> leg = fixedLeg(p.settlement, p.maturity, p.tenor, termStructure->dayCounter());
+	HullWhiteSwaption &swaption = setup.swaption;
+	swaption.a = a;
+	swaption.sigma = sigma;
+	swaption.payer = (p.type == VanillaSwap::Payer);
+	swaption.expiry = termStructure->timeFromReference(leg->dates[0]);
+	for (Size i = 0; i < leg->accruals.size(); i++) {
+		swaption.payTimes.push_back(swaption.expiry + leg->timesFromStart[i]);
+		swaption.coupons.push_back(p.strike * leg->accruals[i]);
 	}
-	std::vector<boost::shared_ptr<CalibrationHelper> > swaptions;
-
-	// define the 100 swaptions used for calibration
-	Size i;
-	for (i = 0; i<numRows; i++) {
-		Size j = numCols - i - 1;
-		Size k = i * numCols + j;
-		boost::shared_ptr<Quote> vol(new SimpleQuote(swaptionVols[k]));
-		swaptions.push_back(boost::shared_ptr<CalibrationHelper>(new
-			SwaptionHelper(swaptionMaturities[i], 
-				Period(swapLengths[j], Years),
-				Handle<Quote>(vol), //const Handle<Quote>& volatility,
-				indexThreeMonths, // boost::shared_ptr<IborIndex>& index
-				indexThreeMonths->tenor(), //Period& fixedLegTenor,
-				indexThreeMonths->dayCounter(), //const DayCounter& fixedLegDayCounter,
-				indexThreeMonths->dayCounter(),
-				rhTermStructure))); // const Handle<YieldTermStructure>& termStructure,
-	} 
-
-	// defining the models
-	boost::shared_ptr<HullWhite> modelHW(new HullWhite(rhTermStructure)); 				
-
-	// perform calibration
-	for (i = 0; i < swaptions.size(); i++) {
-		swaptions[i]->setPricingEngine(boost::shared_ptr<PricingEngine>(
-			new JamshidianSwaptionEngine(modelHW)));
+	swaption.coupons.back() += 1.0;
+	hwJamshidianStrikes(swaption, bondCoefficients(model, swaption.expiry, swaption.expiry, swaption.payTimes));
+
+	// rehedge grid up to the horizon, or the expiry if that comes first
+	Date horizon = std::min(todaysDate + horizonDays * Days, leg->dates[0]);
+	for (Date d = todaysDate; d < horizon; d += rehedgeDays * Days)
+		setup.times.push_back(termStructure->timeFromReference(d));
+	setup.times.push_back(termStructure->timeFromReference(horizon));
+	shortRateDrift(a, sigma, termStructure, setup.times, setup.alpha, setup.alphaIntegral);
+	for (Size k = 0; k < setup.times.size(); k++)
+		setup.coeffs.push_back(bondCoefficients(model, setup.times[k], swaption.expiry, swaption.payTimes));
+	setup.notional = p.notional;
+	setup.paths = paths;
+	setup.blockSize = 256;
+	setup.seed = 42;
+	setup.threads = threads;
+
+	cout << "Simulating " << paths << " paths of " << p.id << " with " << setup.times.size() - 1
+		<< " rehedges on " << threads << " threads" << endl;
+	vector<double> errors = simulateHedgingErrors(setup);
+	HedgeSimulationStats stats = hedgingErrorStats(setup, errors);
+
+	cout << "Swaption Value = " << stats.optionValue << endl;
+	cout << "Hedging error mean = " << stats.mean << ", std dev = " << stats.stdDev << endl;
+	cout << "1% = " << stats.percentile1 << ", 5% = " << stats.percentile5 << ", median = " << stats.median
+		<< ", 95% = " << stats.percentile95 << ", 99% = " << stats.percentile99 << endl;
+
+	// histogram of the hedging error distribution
+	ofstream oFile;
+	oFile.open("hedge_simulation.csv", ios::out | ios::trunc);
+	oFile << "Swaption Value" << "," << stats.optionValue << endl;
+	oFile << "Mean" << "," << stats.mean << endl << "Std Dev" << "," << stats.stdDev << endl;
+	oFile << "Min" << "," << stats.min << endl << "1%" << "," << stats.percentile1 << endl;
+	oFile << "5%" << "," << stats.percentile5 << endl << "Median" << "," << stats.median << endl;
+	oFile << "95%" << "," << stats.percentile95 << endl << "99%" << "," << stats.percentile99 << endl;
+	oFile << "Max" << "," << stats.max << endl << endl;
+	oFile << "Bucket" << "," << "Paths" << endl;
+	Size buckets = 50;
+	Real width = (stats.max - stats.min) / buckets;
+	vector<Size> counts(buckets, 0);
+	for (Size i = 0; i < errors.size(); i++) {
+		Size b = width > 0.0 ? Size((errors[i] - stats.min) / width) : 0;
+		counts[std::min(b, buckets - 1)]++;
 	}
-	LevenbergMarquardt om;
-	modelHW->calibrate(swaptions, om,
-		EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
-
-	/*  perform Swaption pricing  */
-	// set settlement date and define the maturity and tenor of swaption
-	Date settlement(01, July, 2008);
-	Date startDate = calendar.advance(settlement, 7, Years,
-		floatingLegConvention); // maturity
-	Date maturity = calendar.advance(startDate, 6, Years,
-		floatingLegConvention); // tenor
-	Schedule fixedSchedule(startDate, maturity, Period(fixedLegFrequency),
-		calendar, fixedLegConvention, fixedLegConvention,
-		DateGeneration::Forward, false);
-	Schedule floatSchedule(startDate, maturity, Period(floatingLegFrequency),
-		calendar, floatingLegConvention, floatingLegConvention,
-		DateGeneration::Forward, false);
-
-	Rate FixedRate = 0.050826; // strike
-
-	// define underying swap
-	boost::shared_ptr<VanillaSwap> swap(new VanillaSwap(
-		type, 1000.0,
-		fixedSchedule, FixedRate, fixedLegDayCounter,
-		floatSchedule, indexThreeMonths, 0.0,
-		indexThreeMonths->dayCounter()));
-
-	// price underying swap
-	swap->setPricingEngine(boost::shared_ptr<PricingEngine>(
-		new DiscountingSwapEngine(rhTermStructure)));
-
-	// define swaption based on underying swap
-	boost::shared_ptr<Exercise> europeanExercise(
-		new EuropeanExercise(startDate));
-	Swaption atmEuropeanSwaption(swap, europeanExercise);
-
-	// price swaption
-	atmEuropeanSwaption.setPricingEngine(boost::shared_ptr<PricingEngine>(
-		new JamshidianSwaptionEngine(modelHW)));
-	
-	// calculating delta in black-76 based on swaption price
-	Real IV = atmEuropeanSwaption.impliedVolatility(atmEuropeanSwaption.NPV(), rhTermStructure, 0.05);
-	cout << "Start calculating delta." << endl;
-	atmEuropeanSwaption.setPricingEngine(boost::shared_ptr<PricingEngine>(
-		new BlackSwaptionEngine(rhTermStructure, IV)));
-	std::cout << "Black Price :      " << atmEuropeanSwaption.NPV() << std::endl;
-	cout << "End calculating delta." << endl;
-
-	// return results
-	struct Result ret;
-	ret.swapNPV = swap->NPV();
-	ret.swaptionNPV = atmEuropeanSwaption.NPV();
-	return ret;
+	for (Size b = 0; b < buckets; b++)
+		oFile << stats.min + (b + 0.5) * width << "," << counts[b] << endl;
+	oFile.close();
+	return 0;
+}
+
+// years in labels like "7Yr", 0 for anything else such as "9Mo"
+Size labelYears(const string &label) {
+	Size n = 0, i = 0;
+	while (i < label.size() && isdigit(label[i]))
+		n = n * 10 + (label[i++] - '0');
+	return (label.substr(i, 2) == "Yr") ? n : 0;
 }
 
-int main() {
-	Date todaysDate(01, July, 2008);
-	char digits_m[] = { '7', '8', '9', '0', '1', '2'};
-	char digits_d[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
-	char mddd[] = "20080701";
-	int count = 0;
+// usage: SwaptionHedging --replay [first date] [last date] [delay ms]
+// write the DF_/IV_ files as a stream of market updates on stdout, only changed quotes after the first date:
+// DATE 20080702 / DF <pillar> <discount factor> / VOL <expiry> <tenor> <vol in %> / END
+int replay(int argc, char *argv[]) {
+	Date todaysDate = stringToDate((argc > 1) ? argv[1] : "20080701");
+	Date lastDate = stringToDate((argc > 2) ? argv[2] : "20081231");
+	Integer delay = (argc > 3) ? stoi(argv[3]) : 0;
+
+	vector<double> lastDfs;
+	vector<string> lastVols;
+	for (; todaysDate <= lastDate; todaysDate += 1 * Days) {
+		string mddd = dateToString(todaysDate);
+		vector<double> dfs = DiscountFactorVec("DF_" + mddd + ".csv");
+		Parser iv = Parser("IV_" + mddd + ".csv");
+		cout << "DATE " << mddd << "\n";
+		for (Size i = 1; i < dfs.size(); i++)
+			if (lastDfs.empty() || dfs[i] != lastDfs[i])
+				cout << "DF " << i << " " << setprecision(10) << dfs[i] << "\n";
+		vector<string> vols;
+		for (unsigned int i = 0; i < iv.rowCount(); i++)
+			for (unsigned int j = 1; j < iv.columnCount(); j++) {
+				vols.push_back(iv[i][j]);
+				if (lastVols.empty() || vols.back() != lastVols[vols.size() - 1])
+					cout << "VOL " << iv[i][0] << " " << iv.getHeaderElement(j) << " " << iv[i][j] << "\n";
+			}
+		cout << "END" << endl;
+		lastDfs = dfs;
+		lastVols = vols;
+		if (delay > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+	}
+	return 0;
+}
 
-	struct Result r = calculate(string(mddd),todaysDate);
-	cout << "Swap Value = " << r.swapNPV << endl;
-	cout << "Swaption Value = " << r.swaptionNPV << endl <<endl;
+// usage: SwaptionHedging --stream [date] [input] [portfolio.csv] [tolerance]
+// read market updates (as written by --replay) from stdin or a named pipe, update the quotes in place and
+// print the portfolio value and greeks after every END; the curve and model of [date] are the starting point
+int stream(int argc, char *argv[]) {
+	string dateString = (argc > 1) ? argv[1] : "20080701";
+	string input = (argc > 2) ? argv[2] : "-";
+	string portfolioFile = (argc > 3) ? argv[3] : "Portfolio.csv";
+	Real tolerance = (argc > 4) ? stod(argv[4]) : 1.0e-3;
+
+	Market market(stringToDate(dateString), DiscountFactorVec("DF_" + dateString + ".csv"),
+		ImpliedVolatilityVec("IV_" + dateString + ".csv"), tolerance);
+	PortfolioPricer pricer(readPortfolio(portfolioFile), market.termStructure(), market.index(), market.model());
+
+	ifstream file;
+	if (input != "-")
+		file.open(input.c_str());
+	istream &in = (input != "-") ? static_cast<istream &>(file) : cin;
+
+	LatencyHistogram latency;
+	Size updates = 0, recalibrations = 0, ignored = 0, avoided = 0;
+	boost::shared_ptr<MarketTransaction> update; // open from the first update after END to the next END
+	cout << "Date" << "," << "Portfolio Value" << "," << "Delta" << "," << "Vega" << ","
+		<< "Recalibrated" << "," << "Latency (us)" << endl;
+	string line;
+	while (getline(in, line)) {
+		std::istringstream tokens(line);
+		string command;
+		tokens >> command;
+		if (!update && (command == "DATE" || command == "DF" || command == "VOL"))
+			update = boost::shared_ptr<MarketTransaction>(new MarketTransaction(market));
+		if (command == "DATE") {
+			string d;
+			tokens >> d;
+			market.setEvaluationDate(stringToDate(d));
+			dateString = d;
+		} else if (command == "DF") {
+			Size pillar;
+			DiscountFactor df;
+			tokens >> pillar >> df;
+			market.setDiscountFactor(pillar, df);
+			updates++;
+		} else if (command == "VOL") {
+			string expiry, tenor;
+			Volatility vol;
+			tokens >> expiry >> tenor >> vol;
+			Size e = labelYears(expiry), t = labelYears(tenor);
+			if (e >= 1 && e <= 10 && t >= 1 && t <= 10) {
+				market.setVolatility(e, t, vol / 100);
+				updates++;
+			} else
+				ignored++; // outside of the 1-10Yr surface
+		} else if (command == "END") {
+			// react: recalibrate only if needed, then reprice from the updated graph
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			bool recalibrated = update ? update->commit() : market.refresh();
+			if (update)
+				avoided += update->avoided();
+			update.reset();
+			PortfolioValue r = pricer.value();
+			double micros = microsSince(start);
+			latency.add(micros);
+			if (recalibrated)
+				recalibrations++;
+			cout << dateString << "," << r.value << "," << r.delta << "," << r.vega << ","
+				<< recalibrated << "," << micros << endl;
+		} else if (command == "QUIT")
+			break;
+	}
 
+	update.reset();
+	cerr << updates << " quote updates (" << ignored << " outside the surface), " << latency.count()
+		<< " repricings, " << recalibrations << " recalibrations, " << avoided << " curve notifications avoided" << endl;
+	cerr << "latency us: mean " << latency.mean() << ", min " << latency.min() << ", median < "
+		<< latency.quantile(0.5) << ", 99% < " << latency.quantile(0.99) << ", max " << latency.max() << endl;
 	ofstream oFile;
-	oFile.open("result7x6_2008.csv", ios::out | ios::trunc);
-	oFile << "Date" << "," << "Swap Value" << "," << "Swaption Value" << endl;
-
-		for (int mi = 0; mi < 6; mi++) { 
-			char m = digits_m[mi]; // units digits of month, 7,8,9,0,1,2
-			for (char dd = '0'; dd <= '3'; dd++) { // tens digits of day, 0,1,2,3
-				for (int di = 0; di < 10; di++) { 
-					char d = digits_d[di]; // units digits of day, 0 - 9
-					mddd[5] = m;
-					mddd[6] = dd;
-					mddd[7] = d;
-					if (dd == '0' && d == '0') continue; // skip "20xxxx00"
-					if (dd == '3' && d == '2') break; // break at "20xxxx31"
-					if (string(mddd) == "20080931") break; // skip "20xx0931"
-					if (string(mddd) == "20081131") break; // skip "20xx1131"
-					if (m == '0') mddd[4] = '1'; // adjust month when it's October
-
-					cout << mddd << endl;
-					cout << todaysDate << endl;
-
-					struct Result r = calculate(string(mddd),todaysDate); // perform calculation
-					cout << "Swap Value = " << r.swapNPV << endl;
-					cout << "Swaption Value = " << r.swaptionNPV << endl <<endl;
-
-					oFile << string(mddd) << "," << r.swapNPV << "," << r.swaptionNPV << endl;
-					todaysDate += 1 * Days;
-				}
-			}
-		}
+	oFile.open("stream_latency.csv", ios::out | ios::trunc);
+	latency.write(oFile);
+	oFile.close();
+	return 0;
+}
+
+// usage: SwaptionHedging --daemon [date] [port] [tolerance]
+// calibrate once on [date] and answer pricing requests on 127.0.0.1:port until a shutdown request
+int pricingDaemon(int argc, char *argv[]) {
+	string dateString = (argc > 1) ? argv[1] : "20080701";
+	unsigned short port = (unsigned short)((argc > 2) ? stoi(argv[2]) : 5555);
+	Real tolerance = (argc > 3) ? stod(argv[3]) : 1.0e-3;
+
+	Market market(stringToDate(dateString), DiscountFactorVec("DF_" + dateString + ".csv"),
+		ImpliedVolatilityVec("IV_" + dateString + ".csv"), tolerance);
+	cout << "calibrated to: a = " << market.model()->params()[0] << ", "
+		<< "sigma = " << market.model()->params()[1] << endl;
+	PricingDaemon(market).serve(port);
+	return 0;
+}
+
+// usage: SwaptionHedging --request [port] <expiry> <tenor> <strike> <notional> [<expiry> <tenor> <strike> <notional> ...]
+// price payer swaptions on a running daemon in one batch, strike 0 means at-the-money
+// usage: SwaptionHedging --request [port] shutdown
+int pricingRequest(int argc, char *argv[]) {
+	unsigned short port = (unsigned short)((argc > 1) ? stoi(argv[1]) : 5555);
+	vector<char> reply;
+	if (argc > 2 && string(argv[2]) == "shutdown") {
+		sendPricingRequest(port, Shutdown, 0, 0, 0, reply);
+		return 0;
+	}
+
+	vector<PriceRequest> requests;
+	for (int k = 2; k + 3 < argc; k += 4) {
+		PriceRequest r = { stoi(argv[k]), stoi(argv[k + 1]), 1, 0, stod(argv[k + 2]), stod(argv[k + 3]) };
+		requests.push_back(r);
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ResponseHeader response = sendPricingRequest(port, PriceSwaptions, requests.data(),
+		(std::uint32_t)requests.size(), sizeof(PriceRequest), reply);
+	double roundTrip = microsSince(start);
+	QL_REQUIRE(response.status == StatusOk, "pricing daemon returned status " << response.status);
+
+	const PriceResponse *prices = reinterpret_cast<const PriceResponse *>(reply.data());
+	for (Size k = 0; k < response.count; k++)
+		cout << requests[k].expiry << "x" << requests[k].tenor << " struck at " << prices[k].strike
+			<< ": value " << prices[k].value << ", delta " << prices[k].delta << ", vega " << prices[k].vega
+			<< ", forward " << prices[k].forward << endl;
+	cout << "daemon " << response.micros << " us, round trip " << roundTrip << " us" << endl;
+	return 0;
+}
+
+// how the scheduler spread the tasks, idle workers show up as low utilization
+void printWorkerStats(const vector<TaskWorkerStats> &workers) {
+	for (Size w = 0; w < workers.size(); w++)
+		cout << "  worker " << w << ": " << workers[w].tasks << " tasks (" << workers[w].stolen << " stolen), "
+			<< workers[w].busySeconds << " s busy, " << 100.0 * workers[w].utilization << "% utilized" << endl;
+}
+
+// usage: SwaptionHedging --scenarios [date] [scenarios.csv] [threads] [recalibrate all] [portfolio.csv] [reversed]
+// reprice the 10x10 ATM grid and the portfolio under every scenario of the file (see ScenarioAnalytics.hpp);
+// with reversed the scenarios are run again in the opposite order, scenario_order.csv gets the differences
+// and the exit code is 1 if the order changed any result
+int scenarioAnalysis(int argc, char *argv[]) {
+	string dateString = (argc > 1) ? argv[1] : "20080701";
+	string scenarioFile = (argc > 2) ? argv[2] : "Scenarios.csv";
+	unsigned int threads = (argc > 3) ? stoi(argv[3]) : defaultThreadCount();
+	bool recalibrateAll = (argc > 4) && string(argv[4]) == "all";
+	string portfolioFile = (argc > 5) ? argv[5] : "Portfolio.csv";
+	bool checkOrder = (argc > 6) && string(argv[6]) == "reversed";
+
+	StageTimer::instance().enable();
+	vector<Position> positions = readPortfolio(portfolioFile);
+	vector<Scenario> definitions = readScenarios(scenarioFile);
+	vector<double> dfs = DiscountFactorVec("DF_" + dateString + ".csv");
+	vector<double> vols = ImpliedVolatilityVec("IV_" + dateString + ".csv");
+	Market market(stringToDate(dateString), dfs, vols);
+	ScenarioEngine engine(market, dfs, vols, positions);
+	vector<ScenarioMarket> scenarios;
+	for (Size k = 0; k < definitions.size(); k++)
+		scenarios.push_back(engine.shock(definitions[k]));
+
+	Array baseParams = market.model()->params();
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	ScenarioResults results = engine.run(scenarios, threads, recalibrateAll);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << scenarios.size() << " scenarios x " << results.instruments.size() << " instruments on " << threads
+		<< " threads in " << seconds << " s, " << results.calibrations << " calibrations" << endl;
+	printWorkerStats(results.workers);
+
+	// scenario by instrument P&L matrix
+	ofstream oFile;
+	oFile.open("scenario_pnl.csv", ios::out | ios::trunc);
+	oFile << "Scenario" << "," << "a" << "," << "sigma" << "," << "Portfolio";
+	for (Size i = 0; i < results.instruments.size(); i++)
+		oFile << "," << results.instruments[i];
+	oFile << endl;
+	oFile << "Base" << "," << market.model()->params()[0] << "," << market.model()->params()[1] << ",";
+	Real baseValue = 0.0;
+	for (Size i = results.instruments.size() - positions.size(); i < results.instruments.size(); i++)
+		baseValue += results.baseValues[i];
+	oFile << baseValue;
+	for (Size i = 0; i < results.baseValues.size(); i++)
+		oFile << "," << results.baseValues[i];
+	oFile << endl;
+	for (Size k = 0; k < scenarios.size(); k++) {
+		oFile << scenarios[k].id << "," << results.a[k] << "," << results.sigma[k] << "," << results.portfolioPnL[k];
+		for (Size i = 0; i < results.instruments.size(); i++)
+			oFile << "," << results.pnl[k][i];
+		oFile << endl;
+	}
+	oFile.close();
+	StageTimer::instance().write("stages.csv", "trace.json");
+	if (!checkOrder)
+		return 0;
+
+	// the largest absolute difference of every scenario between the two orders, the base row compares the
+	// model the market is left with to the one it had before the first run
+	vector<ScenarioMarket> reversedScenarios(scenarios.rbegin(), scenarios.rend());
+	ScenarioResults reversed = engine.run(reversedScenarios, threads, recalibrateAll);
+	Real worst = 0.0;
+	oFile.open("scenario_order.csv", ios::out | ios::trunc);
+	oFile << "Scenario" << "," << "a" << "," << "sigma" << "," << "P&L" << endl;
+	Real da = std::fabs(market.model()->params()[0] - baseParams[0]);
+	Real dsigma = std::fabs(market.model()->params()[1] - baseParams[1]);
+	worst = std::max(worst, std::max(da, dsigma));
+	oFile << "Base" << "," << da << "," << dsigma << "," << 0.0 << endl;
+	for (Size k = 0; k < scenarios.size(); k++) {
+		Size r = scenarios.size() - 1 - k;
+		da = std::fabs(results.a[k] - reversed.a[r]);
+		dsigma = std::fabs(results.sigma[k] - reversed.sigma[r]);
+		Real dpnl = 0.0;
+		for (Size i = 0; i < results.instruments.size(); i++)
+			dpnl = std::max(dpnl, std::fabs(results.pnl[k][i] - reversed.pnl[r][i]));
+		worst = std::max(worst, std::max(dpnl, std::max(da, dsigma)));
+		oFile << scenarios[k].id << "," << da << "," << dsigma << "," << dpnl << endl;
+	}
+	oFile.close();
+	cout << "reversed order: largest difference " << worst << endl;
+	return worst > 1.0e-10 ? 1 : 0;
+}
+
+// usage: SwaptionHedging --var [date] [confidence] [threads] [portfolio.csv] [first-last ...]
+// historical VaR and ES of the portfolio on [date], the scenarios are the day over day moves of the
+// history windows, by default Jul-Dec 2008 and Jul-Dec 2011, e.g. --var 20111230 0.99 8 Portfolio.csv 20080701-20081231
+int historicalVaR(int argc, char *argv[]) {
+	string dateString = (argc > 1) ? argv[1] : "20111230";
+	Real confidence = (argc > 2) ? stod(argv[2]) : 0.99;
+	unsigned int threads = (argc > 3) ? stoi(argv[3]) : defaultThreadCount();
+	string portfolioFile = (argc > 4) ? argv[4] : "Portfolio.csv";
+	vector<string> windows;
+	for (int i = 5; i < argc; i++)
+		windows.push_back(argv[i]);
+	if (windows.empty()) {
+		windows.push_back("20080701-20081231");
+		windows.push_back("20110701-20111231");
+	}
+
+	StageTimer::instance().enable();
+	vector<Position> positions = readPortfolio(portfolioFile);
+	vector<double> dfs = DiscountFactorVec("DF_" + dateString + ".csv");
+	vector<double> vols = ImpliedVolatilityVec("IV_" + dateString + ".csv");
+	Market market(stringToDate(dateString), dfs, vols);
+	ScenarioEngine engine(market, dfs, vols, positions, false);
+	vector<ScenarioMarket> scenarios;
+	for (Size w = 0; w < windows.size(); w++) {
+		QL_REQUIRE(windows[w].size() == 17 && windows[w][8] == '-', "history window " << windows[w] << " is not first-last");
+		vector<ScenarioMarket> window = engine.historicalScenarios(stringToDate(windows[w].substr(0, 8)),
+			stringToDate(windows[w].substr(9, 8)));
+		scenarios.insert(scenarios.end(), window.begin(), window.end());
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	ScenarioResults results = engine.run(scenarios, threads);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << scenarios.size() << " historical scenarios x " << positions.size() << " positions on " << threads
+		<< " threads in " << seconds << " s, " << results.calibrations << " calibrations" << endl;
+	printWorkerStats(results.workers);
+
+	TailRisk portfolio = historicalTailRisk(results.portfolioPnL, confidence);
+	cout << "Portfolio " << confidence * 100 << "% VaR = " << portfolio.valueAtRisk
+		<< ", ES = " << portfolio.expectedShortfall << " (" << portfolio.tailScenarios << " tail scenarios)" << endl;
+
+	// VaR and ES of the portfolio and of every position on its own
+	ofstream oFile;
+	oFile.open("var.csv", ios::out | ios::trunc);
+	oFile << "Id" << "," << "Value" << "," << "VaR" << "," << "ES" << endl;
+	Real baseValue = 0.0;
+	for (Size i = 0; i < positions.size(); i++)
+		baseValue += results.baseValues[i];
+	oFile << "Portfolio" << "," << baseValue << "," << portfolio.valueAtRisk << "," << portfolio.expectedShortfall << endl;
+	for (Size i = 0; i < positions.size(); i++) {
+		vector<double> pnl;
+		for (Size k = 0; k < scenarios.size(); k++)
+			pnl.push_back(results.pnl[k][i]);
+		TailRisk risk = historicalTailRisk(pnl, confidence);
+		oFile << positions[i].id << "," << results.baseValues[i] << "," << risk.valueAtRisk << "," << risk.expectedShortfall << endl;
+	}
 	oFile.close();
 
+	oFile.open("var_scenarios.csv", ios::out | ios::trunc);
+	oFile << "Scenario" << "," << "a" << "," << "sigma" << "," << "Portfolio";
+	for (Size i = 0; i < positions.size(); i++)
+		oFile << "," << positions[i].id;
+	oFile << endl;
+	for (Size k = 0; k < scenarios.size(); k++) {
+		oFile << scenarios[k].id << "," << results.a[k] << "," << results.sigma[k] << "," << results.portfolioPnL[k];
+		for (Size i = 0; i < positions.size(); i++)
+			oFile << "," << results.pnl[k][i];
+		oFile << endl;
+	}
+	oFile.close();
+	StageTimer::instance().write("stages.csv", "trace.json");
+	return 0;
+}
+
+// usage: SwaptionHedging --g2 [first date] [last date] [basket] [nodes] [engine]
+// calibrate G2++ every date next to the Hull-White model of the Market, on the co-terminal diagonal or the whole
+// 10x10 surface (basket "surface"), with FastG2SwaptionEngine or QuantLib's G2SwaptionEngine (engine "ql")
+int g2Calibration(int argc, char *argv[]) {
+	Date todaysDate = stringToDate((argc > 1) ? argv[1] : "20080701");
+	Date lastDate = stringToDate((argc > 2) ? argv[2] : "20081231");
+	bool surface = (argc > 3) && string(argv[3]) == "surface";
+	Size nodes = (argc > 4) ? stoi(argv[4]) : 32;
+	bool quantLibEngine = (argc > 5) && string(argv[5]) == "ql";
+
+	string firstDate = dateToString(todaysDate);
+	vector<double> vols = ImpliedVolatilityVec("IV_" + firstDate + ".csv");
+	Market market(todaysDate, DiscountFactorVec("DF_" + firstDate + ".csv"), vols);
+
+	// the G2 basket is built once on the market's curve and its own vol quotes, every date only sets the quotes
+	boost::shared_ptr<G2> g2(new G2(market.termStructure()));
+	boost::shared_ptr<PricingEngine> engine;
+	if (quantLibEngine)
+		engine = boost::shared_ptr<PricingEngine>(new G2SwaptionEngine(g2, 6.0, 16));
+	else
+		engine = boost::shared_ptr<PricingEngine>(new FastG2SwaptionEngine(g2, nodes));
+	vector<boost::shared_ptr<SimpleQuote> > quotes;
+	vector<boost::shared_ptr<CalibrationHelper> > helpers;
+	vector<Size> basket;
+	for (Size k = 0; k < vols.size(); k++) {
+		quotes.push_back(boost::shared_ptr<SimpleQuote>(new SimpleQuote(vols[k])));
+		if (!surface && k / 10 + k % 10 != 9)
+			continue;
+		basket.push_back(k);
+		helpers.push_back(boost::shared_ptr<CalibrationHelper>(new
+			SwaptionHelper(Period(k / 10 + 1, Years),
+				Period(k % 10 + 1, Years),
+				Handle<Quote>(quotes[k]),
+				market.index(),
+				market.index()->tenor(),
+				market.index()->dayCounter(),
+				market.index()->dayCounter(),
+				market.termStructure())));
+		helpers.back()->setPricingEngine(engine);
+	}
+	LevenbergMarquardt om;
+	EndCriteria endCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8);
+	cout << "G2++ on " << helpers.size() << " swaptions with " << (quantLibEngine ? "G2SwaptionEngine"
+		: "FastG2SwaptionEngine, " + to_string(nodes) + " nodes") << endl;
+
+	ofstream oFile;
+	oFile.open("g2_calibration.csv", ios::out | ios::trunc);
+	oFile << "Date" << "," << "a" << "," << "sigma" << "," << "b" << "," << "eta" << "," << "rho" << ","
+		<< "G2 RMS Error" << "," << "HW RMS Error" << "," << "G2 ms" << "," << "HW ms" << endl;
+	double g2Total = 0.0, hwTotal = 0.0;
+	Size dates = 0;
+	for (; todaysDate <= lastDate; todaysDate += 1 * Days) {
+		string mddd = dateToString(todaysDate);
+		double hwMillis;
+		{
+			MarketTransaction update(market);
+			loadMarket(market, mddd, todaysDate);
+			vols = ImpliedVolatilityVec("IV_" + mddd + ".csv");
+			for (Size k = 0; k < basket.size(); k++)
+				quotes[basket[k]]->setValue(vols[basket[k]]);
+			// both models start from yesterday's parameters, the commit always recalibrates Hull-White
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			update.commit(true);
+			hwMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		}
 
-	system("pause");
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		g2->calibrate(helpers, om, endCriteria);
+		double g2Millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		Real sum = 0.0;
+		for (Size i = 0; i < helpers.size(); i++)
+			sum += helpers[i]->calibrationError() * helpers[i]->calibrationError();
+		Real g2Error = std::sqrt(sum / helpers.size());
+
+		Array p = g2->params();
+		oFile << mddd << "," << p[0] << "," << p[1] << "," << p[2] << "," << p[3] << "," << p[4] << ","
+			<< g2Error << "," << market.calibrationError() << "," << g2Millis << "," << hwMillis << endl;
+		cout << mddd << ": G2 " << g2Millis << " ms, error " << g2Error << "; HW " << hwMillis
+			<< " ms, error " << market.calibrationError() << endl;
+		g2Total += g2Millis;
+		hwTotal += hwMillis;
+		dates++;
+	}
+	oFile.close();
+	cout << dates << " dates: G2++ " << g2Total / 1000.0 << " s, Hull-White " << hwTotal / 1000.0 << " s" << endl;
 	return 0;
+}
+
+// usage: SwaptionHedging --bermudan [date] [paths] [threads] [portfolio.csv] [lattice steps per year]
+// price the first swaption of the portfolio as a Bermudan, exercisable on its expiry and every fixed leg date
+// after it into the rest of the swap, by Longstaff-Schwartz Monte Carlo on the calibrated Hull-White model, on
+// its trinomial lattice and by finite differences with as many time steps
+int bermudan(int argc, char *argv[]) {
+	string dateString = (argc > 1) ? argv[1] : "20080701";
+	Size paths = (argc > 2) ? stoi(argv[2]) : 100000;
+	unsigned int threads = (argc > 3) ? stoi(argv[3]) : defaultThreadCount();
+	string portfolioFile = (argc > 4) ? argv[4] : "Portfolio.csv";
+	Size stepsPerYear = (argc > 5) ? stoi(argv[5]) : 50;
+
+	vector<Position> positions = readPortfolio(portfolioFile);
+	Size n = 0;
+	while (n < positions.size() && !positions[n].isSwaption)
+		n++;
+	QL_REQUIRE(n < positions.size(), "no swaption in " << portfolioFile);
+	const Position &p = positions[n];
+
+	Date todaysDate = stringToDate(dateString);
+	Market market(todaysDate, DiscountFactorVec("DF_" + dateString + ".csv"),
+		ImpliedVolatilityVec("IV_" + dateString + ".csv"));
+	const HullWhite &model = *market.model();
+	Handle<YieldTermStructure> termStructure = market.termStructure();
+	Real a = model.params()[0], sigma = model.params()[1];
+	cout << "calibrated to: a = " << a << ", sigma = " << sigma << endl;
+
+	// the longest swap on a unit notional, exercisable into its remaining payments on every fixed leg date
+	BermudanLSMSetup setup;
+	boost::shared_ptr<const CachedSchedule> leg = fixedLeg(p.settlement, p.maturity, p.tenor, termStructure->dayCounter());
+	BermudanSwaption &swaption = setup.swaption;
+	swaption.a = a;
+	swaption.sigma = sigma;
+	swaption.payer = (p.type == VanillaSwap::Payer);
+	Time expiry = termStructure->timeFromReference(leg->dates[0]);
+	for (Size i = 0; i < leg->accruals.size(); i++) {
+		swaption.payTimes.push_back(expiry + leg->timesFromStart[i]);
+		swaption.coupons.push_back(p.strike * leg->accruals[i]);
+		swaption.exerciseTimes.push_back(i == 0 ? expiry : swaption.payTimes[i - 1]);
+		swaption.firstCoupon.push_back(i);
+	}
+	swaption.coupons.back() += 1.0;
+	vector<Time> times(1, 0.0);
+	times.insert(times.end(), swaption.exerciseTimes.begin(), swaption.exerciseTimes.end());
+	vector<Real> alpha;
+	shortRateDrift(a, sigma, termStructure, times, alpha, setup.alphaIntegral);
+	setup.alpha.assign(alpha.begin() + 1, alpha.end());
+
+	// the co-terminal Europeans, every one of them is worth less than the Bermudan
+	vector<Real> europeans;
+	for (Size k = 0; k < swaption.exerciseTimes.size(); k++) {
+		Time t = swaption.exerciseTimes[k];
+		vector<Time> payTimes(swaption.payTimes.begin() + k, swaption.payTimes.end());
+		setup.coeffs.push_back(bondCoefficients(model, t, t, payTimes));
+		HullWhiteSwaption european;
+		european.a = a;
+		european.sigma = sigma;
+		european.payer = swaption.payer;
+		european.expiry = t;
+		european.payTimes = payTimes;
+		european.coupons.assign(swaption.coupons.begin() + k, swaption.coupons.end());
+		hwJamshidianStrikes(european, setup.coeffs.back());
+		europeans.push_back(hwSwaptionValue(european, bondCoefficients(model, 0.0, t, payTimes), alpha[0]));
+	}
+	setup.basisSize = 4;
+	setup.regressionPaths = paths;
+	setup.pricingPaths = paths;
+	setup.dualPaths = std::max<Size>(paths / 25, 1);
+	setup.innerPaths = 250;
+	setup.blockSize = 256;
+	setup.seed = 42;
+	setup.threads = threads;
+
+	cout << "Pricing " << p.id << " as a Bermudan with " << swaption.exerciseTimes.size() << " exercise dates, "
+		<< paths << " paths on " << threads << " threads" << endl;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	BermudanLSMResults results = priceBermudanLSM(setup);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// the same swaption on the model's trinomial tree
+	vector<LatticeSwaption> latticeSwaptions(1);
+	latticeSwaptions[0].exerciseTimes = swaption.exerciseTimes;
+	latticeSwaptions[0].payTimes = swaption.payTimes;
+	latticeSwaptions[0].coupons = swaption.coupons;
+	latticeSwaptions[0].payer = swaption.payer;
+	vector<Time> latticeTimes = latticeTimeGrid(latticeSwaptions, 1.0 / stepsPerYear);
+	vector<DiscountFactor> latticeDiscounts;
+	for (Size i = 0; i < latticeTimes.size(); i++)
+		latticeDiscounts.push_back(termStructure->discount(latticeTimes[i]));
+	Real latticeValue = HullWhiteLattice(a, sigma, latticeTimes, latticeDiscounts).price(latticeSwaptions)[0];
+
+	// and on the finite difference grid
+	vector<HullWhiteFdSwaption> fdSwaptions(1);
+	fdSwaptions[0].swaption = swaption;
+	fdSwaptions[0].coeffs = setup.coeffs;
+	HullWhiteFdSetup fdSetup;
+	fdSetup.a = a;
+	fdSetup.sigma = sigma;
+	fdSetup.times = hullWhiteFdTimeGrid(fdSwaptions, 1.0 / stepsPerYear);
+	vector<Real> fdIntegral;
+	shortRateDrift(a, sigma, termStructure, fdSetup.times, fdSetup.alpha, fdIntegral);
+	fdSetup.xPoints = 201;
+	fdSetup.xStdDevs = 5.0;
+	fdSetup.dampingSteps = 2;
+	fdSetup.lanes = 1;
+	fdSetup.threads = 1;
+	Real fdValue = priceHullWhiteFd(fdSetup, fdSwaptions)[0];
+
+	Real largestEuropean = *std::max_element(europeans.begin(), europeans.end());
+	cout << "Bermudan lower bound = " << p.notional * results.lowerBound << " (std error "
+		<< std::fabs(p.notional) * results.lowerStdError << ")" << endl;
+	cout << "Bermudan upper bound = " << p.notional * results.upperBound << " (std error "
+		<< std::fabs(p.notional) * results.upperStdError << ")" << endl;
+	cout << "in sample = " << p.notional * results.inSample << ", largest European = "
+		<< p.notional * largestEuropean << ", " << seconds << " s" << endl;
+	cout << "lattice (" << stepsPerYear << " steps per year) = " << p.notional * latticeValue << endl;
+	cout << "finite differences (" << fdSetup.xPoints << " points, " << fdSetup.times.size() - 1 << " steps) = "
+		<< p.notional * fdValue << endl;
 
+	ofstream oFile;
+	oFile.open("bermudan_lsm.csv", ios::out | ios::trunc);
+	oFile << "Lower Bound" << "," << p.notional * results.lowerBound << "," << std::fabs(p.notional) * results.lowerStdError << endl;
+	oFile << "Upper Bound" << "," << p.notional * results.upperBound << "," << std::fabs(p.notional) * results.upperStdError << endl;
+	oFile << "In Sample" << "," << p.notional * results.inSample << endl;
+	oFile << "Lattice" << "," << p.notional * latticeValue << endl;
+	oFile << "Finite Differences" << "," << p.notional * fdValue << endl << endl;
+	oFile << "Exercise Date" << "," << "European" << "," << "Exercise Probability";
+	for (Size j = 0; j < setup.basisSize; j++)
+		oFile << "," << "Coefficient " << j;
+	oFile << endl;
+	for (Size k = 0; k < swaption.exerciseTimes.size(); k++) {
+		oFile << leg->dates[k] << "," << p.notional * europeans[k] << "," << results.exerciseProbability[k];
+		for (Size j = 0; j < results.coefficients[k].size(); j++)
+			oFile << "," << results.coefficients[k][j];
+		oFile << endl;
+	}
+	oFile.close();
+	return 0;
 }
 
+// one date of the backtest on its way through the pipeline
+struct BacktestDate {
+	Date date;
+	string name; // like "20080701"
+	MarketQuotes quotes;
+	PortfolioValue value;
+	Real a; // the model the date was priced with
+	Real sigma;
+	Real pnl;
+	Real cumulativePnL;
+};
+
+// usage: SwaptionHedging [portfolio.csv] [first date] [last date] [output.csv] [loader threads]
+//        SwaptionHedging --resume [portfolio.csv] [first date] [last date] [output.csv] [loader threads]
+// every completed date goes to output.csv.checkpoint; --resume starts after the last date in it
+int main(int argc, char *argv[]) {
+	string mode = (argc > 1) ? argv[1] : "";
+	bool resume = (mode == "--resume");
+	if (resume) {
+		argc--;
+		argv++;
+		mode = (argc > 1) ? argv[1] : "";
+	}
+	if (mode == "--simulate")
+		return simulate(argc - 1, argv + 1);
+	if (mode == "--replay")
+		return replay(argc - 1, argv + 1);
+	if (mode == "--stream")
+		return stream(argc - 1, argv + 1);
+	if (mode == "--daemon")
+		return pricingDaemon(argc - 1, argv + 1);
+	if (mode == "--request")
+		return pricingRequest(argc - 1, argv + 1);
+	if (mode == "--scenarios")
+		return scenarioAnalysis(argc - 1, argv + 1);
+	if (mode == "--var")
+		return historicalVaR(argc - 1, argv + 1);
+	if (mode == "--g2")
+		return g2Calibration(argc - 1, argv + 1);
+	if (mode == "--bermudan")
+		return bermudan(argc - 1, argv + 1);
+
+	string portfolioFile = (argc > 1) ? argv[1] : "Portfolio.csv";
+	Date todaysDate = stringToDate((argc > 2) ? argv[2] : "20080701");
+	Date lastDate = stringToDate((argc > 3) ? argv[3] : "20081231");
+	string outputFile = (argc > 4) ? argv[4] : "result_portfolio.csv";
+	unsigned int loaders = (argc > 5) ? stoi(argv[5]) : 2;
+
+	StageTimer::instance().enable();
+	vector<Position> positions = readPortfolio(portfolioFile);
+	cout << positions.size() << " positions on " << groupPositions(positions).size() << " distinct schedules" << endl;
+
+	// the curve, model and instruments of the first date are reused for all later dates
+	AllocationCount setupStart = allocationCount();
+	string firstDate = dateToString(todaysDate);
+	Market market(todaysDate, DiscountFactorVec("DF_" + firstDate + ".csv"),
+		ImpliedVolatilityVec("IV_" + firstDate + ".csv"));
+	PortfolioPricer pricer(positions, market.termStructure(), market.index(), market.model());
+	AllocationCount setupEnd = allocationCount();
+	CounterRegistry::instance().snapshot("setup");
+
+	ofstream oFile;
+	oFile.open(outputFile.c_str(), ios::out | ios::trunc);
+	oFile << "Date" << "," << "Swap Value" << "," << "Swaption Value" << "," << "Portfolio Value" << ","
+		<< "Delta" << "," << "Vega" << "," << "PnL" << "," << "Cumulative PnL" << endl;
+	ofstream pFile;
+	pFile.open(("positions_" + outputFile).c_str(), ios::out | ios::trunc);
+	pFile << "Date" << "," << "Id" << "," << "Value" << "," << "Delta" << "," << "Vega" << endl;
+
+	// the rows of a completed date, from the pipeline or from the checkpoint of an earlier run
+	auto writeDate = [&](const CheckpointRecord &r) {
+		oFile << r.date << "," << r.swapValue << "," << r.swaptionValue << "," << r.value << ","
+			<< r.delta << "," << r.vega << "," << r.pnl << "," << r.cumulativePnL << endl;
+		for (Size k = 0; k < positions.size(); k++)
+			pFile << r.date << "," << positions[k].id << "," << r.positions[3 * k] << ","
+				<< r.positions[3 * k + 1] << "," << r.positions[3 * k + 2] << endl;
+	};
+
+	// dates completed by an earlier run of the same portfolio and first date are not run again; every date
+	// calibrates from the same starting parameters, so the later dates come out as they would have in one run
+	Real lastValue = 0.0, cumulativePnL = 0.0;
+	bool first = true;
+	// keyed by what changes the results: the portfolio's contents and the first date, and a tag to bump when the
+	// pricing of a date changes. Run-time knobs like the loader threads or the file name are left out
+	ostringstream checkpointKey;
+	checkpointKey << "backtest v1 portfolio " << hex << fileHash(portfolioFile) << dec << " from " << firstDate;
+	BacktestCheckpoint checkpoint(outputFile + ".checkpoint", checkpointKey.str(), positions.size(), resume);
+	Size resumed = 0;
+	while (resumed < checkpoint.completed().size() && todaysDate <= lastDate
+		&& checkpoint.completed()[resumed].date == dateToString(todaysDate)) {
+		writeDate(checkpoint.completed()[resumed]);
+		resumed++;
+		todaysDate += 1 * Days;
+	}
+	// an earlier last date writes just its dates and leaves the later records in the checkpoint. Records that
+	// stop following on from the first date before the last date are not priced over, the run is refused
+	QL_REQUIRE(resumed == checkpoint.completed().size() || todaysDate > lastDate,
+		outputFile << ".checkpoint has " << checkpoint.completed()[resumed].date << " where "
+		<< dateToString(todaysDate) << " was expected, remove it to run from the first date");
+	if (resumed > 0) {
+		const CheckpointRecord &last = checkpoint.completed()[resumed - 1];
+		lastValue = last.value;
+		cumulativePnL = last.cumulativePnL;
+		first = false;
+		cout << "resuming after " << last.date << ", " << resumed << " dates from the checkpoint" << endl;
+	}
+
+	// one set of market data files per calendar day, e.g. DF_20080701.csv and IV_20080701.csv. The files are
+	// read ahead by the loaders while the one Market calibrates and prices the dates in order, and a writer
+	// appends the results behind it
+	Size avoided = 0;
+	Arena dateArena;
+	Size maxAlive = 0, datesAlive = 0; // arena allocations a date left alive at its release
+	Pipeline<BacktestDate> pipeline;
+	pipeline.addStage("load", loaders, [&](BacktestDate &d) {
+		d.quotes = readMarketQuotes(d.name);
+	});
+	// QuantLib keeps the evaluation date and the observers of the one curve and model in globals, so this
+	// stage has a single worker however many dates are waiting
+	pipeline.addStage("calibrate and price", 1, [&](BacktestDate &d) {
+		cout << d.name << endl;
+		ScopedStage dateStage("date", d.name);
+
+		// what the date allocates, the calibration and the legs and engine results of the repricing, comes from
+		// the arena and goes in one release; the value is copied out to the heap for the writer
+		PortfolioValue value;
+		{
+			ArenaScope scope(dateArena);
+			// all quotes of the date in one transaction, then recalibrate every date from the default parameters
+			// as the per-date rebuild did
+			MarketTransaction update(market);
+			market.setMarket(d.date, d.quotes.dfs, d.quotes.vols);
+			update.commit(true);
+			avoided += update.avoided();
+			value = pricer.value(); // perform calculation
+		}
+		d.value = value;
+		COUNT("arena allocations", dateArena.allocations());
+		Size alive = dateArena.release(); // what still points into the date's blocks keeps them
+		COUNT("arena allocations alive at release", alive);
+		dateStage.arg("arena allocations alive at release", Real(alive));
+		maxAlive = std::max(maxAlive, alive);
+		datesAlive += (alive > 0);
+		d.a = market.model()->params()[0];
+		d.sigma = market.model()->params()[1];
+		d.pnl = first ? 0.0 : d.value.value - lastValue;
+		cumulativePnL += d.pnl;
+		d.cumulativePnL = cumulativePnL;
+		lastValue = d.value.value;
+		first = false;
+		cout << "Portfolio Value = " << d.value.value << ", Delta = " << d.value.delta << ", PnL = " << d.pnl << endl << endl;
+
+		// what the date cost, a full recalibration or a notification storm shows up here
+		COUNTER_SET("model notifications", market.notifications().modelUpdates);
+		if (allocationCounting())
+			COUNTER_SET("heap allocations", allocationCount().allocations);
+		CounterRegistry::instance().snapshot(d.name);
+	}, true);
+	pipeline.addStage("write", 1, [&](BacktestDate &d) {
+		ScopedStage outputStage("output", d.name);
+		const PortfolioValue &v = d.value;
+		CheckpointRecord r = { d.name, d.a, d.sigma, v.swapValue, v.swaptionValue, v.value, v.delta, v.vega,
+			d.pnl, d.cumulativePnL, vector<double>() };
+		for (Size k = 0; k < v.positions.size(); k++) {
+			r.positions.push_back(v.positions[k].value);
+			r.positions.push_back(v.positions[k].delta);
+			r.positions.push_back(v.positions[k].vega);
+		}
+		writeDate(r);
+		checkpoint.append(r); // after the rows, a date in the checkpoint is complete in the output
+	}, true);
+
+	Size dateCount = (lastDate >= todaysDate) ? Size(lastDate - todaysDate) + 1 : 0;
+	chrono::steady_clock::time_point runStart = chrono::steady_clock::now();
+	pipeline.run(dateCount, [&](Size i) {
+		BacktestDate d;
+		d.date = todaysDate + Integer(i);
+		d.name = dateToString(d.date);
+		return d;
+	});
+	double runSeconds = chrono::duration<double>(chrono::steady_clock::now() - runStart).count();
+	cout << dateCount << " dates in " << runSeconds << " s" << endl;
+	for (Size s = 0; s < pipeline.stats().size(); s++) {
+		const PipelineStageStats &stage = pipeline.stats()[s];
+		cout << "  " << stage.name << ": " << stage.workers << " workers, " << stage.busySeconds << " s busy, "
+			<< 100.0 * stage.busySeconds / (stage.workers * runSeconds) << "% utilized" << endl;
+	}
+	oFile.close();
+	pFile.close();
+	AllocationCount runEnd = allocationCount();
+	MarketNotifications n = market.notifications();
+	cout << n.quoteChanges << " quote changes, curve notified " << n.curveUpdates << " times (" << avoided
+		<< " notifications avoided), model notified " << n.modelUpdates << " times" << endl;
+	// where the run spent its time, the trace opens in chrome://tracing or ui.perfetto.dev
+	StageTimer::instance().write("stages.csv", "trace.json");
+	StageTimer::instance().enable(false);
+	ofstream cFile;
+	cFile.open("counters.csv", ios::out | ios::trunc);
+	CounterRegistry::instance().write(cFile);
+	cFile.close();
+
+	cout << "arena allocations alive at release: " << datesAlive << " of " << dateCount
+		<< " dates, at most " << maxAlive << " on a date" << endl;
+
+	// per date of this run, the dates restored from the checkpoint cost nothing. Without the arena every
+	// allocation of a date would go to the heap, so the two together are the cost without it
+	if (allocationCounting() && dateCount > 0) {
+		cout << "allocations: " << setupEnd.allocations - setupStart.allocations << " to build the graph, "
+			<< (runEnd.allocations - setupEnd.allocations) / dateCount << " from the heap per date ("
+			<< (runEnd.bytes - setupEnd.bytes) / dateCount << " bytes) and "
+			<< (runEnd.arenaAllocations - setupEnd.arenaAllocations) / dateCount << " from the arena ("
+			<< (runEnd.arenaBytes - setupEnd.arenaBytes) / dateCount << " bytes)" << endl;
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,97 @@
+#include "HullWhiteAnalytics.hpp"
+#include "Counters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+HullWhiteStep hwExactStep(double a, double sigma, double dt) {
+	double e = std::exp(-a * dt);
+	double varX = sigma * sigma * (1.0 - e * e) / (2.0 * a);
+	double varY = sigma * sigma / (a * a) * (dt - 2.0 * (1.0 - e) / a + (1.0 - e * e) / (2.0 * a));
+	double cov = sigma * sigma / (2.0 * a * a) * (1.0 - e) * (1.0 - e);
+	HullWhiteStep step;
+	step.decay = e;
+	step.mean = (1.0 - e) / a;
+	step.sdX = std::sqrt(varX);
+	step.sdY = std::sqrt(varY);
+	step.rho = (varX > 0.0 && varY > 0.0) ? cov / (step.sdX * step.sdY) : 0.0;
+	return step;
+}
+
+std::vector<double> hwTimeGrid(std::vector<double> mandatory, double maxStep) {
+	const double tolerance = 1.0e-10;
+	std::sort(mandatory.begin(), mandatory.end());
+	std::vector<double> times(1, 0.0);
+	for (std::size_t k = 0; k < mandatory.size(); k++) {
+		double t0 = times.back(), dt = mandatory[k] - t0;
+		if (dt <= tolerance)
+			continue;
+		std::size_t steps = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(dt / maxStep - tolerance)));
+		for (std::size_t s = 1; s < steps; s++)
+			times.push_back(t0 + dt * s / steps);
+		times.push_back(mandatory[k]);
+	}
+	return times;
+}
+
+double normalCdf(double x) {
+	return 0.5 * std::erfc(-x * 0.70710678118654752440);
+}
+
+double hwSwapValue(const HullWhiteSwaption &swaption, const BondCoefficients &coeffs, double r) {
+	double value = coeffs.A[0] * std::exp(-coeffs.B[0] * r);
+	for (std::size_t i = 0; i < swaption.coupons.size(); i++)
+		value -= swaption.coupons[i] * coeffs.A[i + 1] * std::exp(-coeffs.B[i + 1] * r);
+	return swaption.payer ? value : -value;
+}
+
+double hwSwaptionValue(const HullWhiteSwaption &swaption, const BondCoefficients &coeffs, double r) {
+	double tau = swaption.expiry - coeffs.t;
+	if (tau <= 1.0e-10) { // at expiry, exercise if the swap is worth something
+		double swap = hwSwapValue(swaption, coeffs, r);
+		return swap > 0.0 ? swap : 0.0;
+	}
+
+	// volatility of the forward bond prices up to the expiry, without the B(expiry, payTime) factor
+	double a = swaption.a;
+	double v = swaption.sigma * std::sqrt((1.0 - std::exp(-2.0 * a * tau)) / (2.0 * a));
+	double P0 = coeffs.A[0] * std::exp(-coeffs.B[0] * r);
+	double value = 0.0;
+	for (std::size_t i = 0; i < swaption.coupons.size(); i++) {
+		double Pi = coeffs.A[i + 1] * std::exp(-coeffs.B[i + 1] * r);
+		double X = swaption.strikes[i];
+		double sigmaP = v * (1.0 - std::exp(-a * (swaption.payTimes[i] - swaption.expiry))) / a;
+		double h = std::log(Pi / (P0 * X)) / sigmaP + 0.5 * sigmaP;
+		// payer swaption = put on the coupon bond, receiver swaption = call
+		if (swaption.payer)
+			value += swaption.coupons[i] * (X * P0 * normalCdf(-h + sigmaP) - Pi * normalCdf(-h));
+		else
+			value += swaption.coupons[i] * (Pi * normalCdf(h) - X * P0 * normalCdf(h - sigmaP));
+	}
+	return value;
+}
+
+double hwJamshidianStrikes(HullWhiteSwaption &swaption, const BondCoefficients &expiryCoeffs) {
+	std::size_t n = swaption.coupons.size();
+	// the coupon bond is decreasing and convex in r, so Newton converges monotonically
+	double r = 0.05;
+	for (int iteration = 0; iteration < 100; iteration++) {
+		double f = -1.0, df = 0.0;
+		for (std::size_t i = 0; i < n; i++) {
+			double P = expiryCoeffs.A[i + 1] * std::exp(-expiryCoeffs.B[i + 1] * r);
+			f += swaption.coupons[i] * P;
+			df -= swaption.coupons[i] * expiryCoeffs.B[i + 1] * P;
+		}
+		double step = f / df;
+		r -= step;
+		COUNT("jamshidian newton iterations", 1);
+		if (std::fabs(step) < 1.0e-14)
+			break;
+		if (iteration == 99)
+			throw std::runtime_error("Jamshidian critical rate did not converge");
+	}
+	swaption.strikes.resize(n);
+	for (std::size_t i = 0; i < n; i++)
+		swaption.strikes[i] = expiryCoeffs.A[i + 1] * std::exp(-expiryCoeffs.B[i + 1] * r);
+	return r;
+}
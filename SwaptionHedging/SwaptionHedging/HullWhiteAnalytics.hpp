@@ -0,0 +1,57 @@
+#ifndef     _HULLWHITEANALYTICS_HPP_
+# define    _HULLWHITEANALYTICS_HPP_
+
+#include <vector>
+
+// This file and HullWhiteAnalytics.cpp price European swaptions in the Hull-White One Factor model
+// at any future time t and short rate r, with no QuantLib objects, so it can run inside parallel
+// simulation loops. Bond prices come from P(t,T) = A(t,T)*exp(-B(t,T)*r), the coefficients are
+// filled in once from the calibrated HullWhite::discountBond and reused for every path.
+
+// bond coefficients of the swap start date (index 0) and every fixed leg payment date (index 1..n), seen from time t
+struct BondCoefficients {
+	double t;
+	std::vector<double> A;
+	std::vector<double> B;
+};
+
+// a European swaption on a unit notional swap, the underlying starts at the expiry
+struct HullWhiteSwaption {
+	double a;
+	double sigma;
+	double expiry;
+	std::vector<double> payTimes; // fixed leg payment times
+	std::vector<double> coupons; // strike * accrual, the last one includes the notional
+	std::vector<double> strikes; // Jamshidian strikes of the bond options
+	bool payer;
+};
+
+// exact joint transition over a step dt of the zero mean OU factor x of the short rate and of its integral y:
+// x' = decay * x + sdX * z1, y = mean * x + sdY * (rho * z1 + sqrt(1 - rho^2) * z2), z1 and z2 independent normals
+struct HullWhiteStep {
+	double decay;
+	double mean;
+	double sdX;
+	double sdY;
+	double rho;
+};
+
+HullWhiteStep hwExactStep(double a, double sigma, double dt);
+
+// today and the mandatory times in order, with equal steps of at most maxStep between them; times closer than
+// 1e-10 are the same time
+std::vector<double> hwTimeGrid(std::vector<double> mandatory, double maxStep);
+
+double normalCdf(double x);
+
+// value of the underlying swap (payer: floating minus fixed) at time t and short rate r
+double hwSwapValue(const HullWhiteSwaption &swaption, const BondCoefficients &coeffs, double r);
+
+// swaption value at time t and short rate r by Jamshidian decomposition into zero bond options
+double hwSwaptionValue(const HullWhiteSwaption &swaption, const BondCoefficients &coeffs, double r);
+
+// solve for the short rate at expiry where the fixed leg is worth par and store the bond option strikes,
+// expiryCoeffs must be seen from the expiry time; returns that critical rate
+double hwJamshidianStrikes(HullWhiteSwaption &swaption, const BondCoefficients &expiryCoeffs);
+
+#endif /*!_HULLWHITEANALYTICS_HPP_*/
@@ -0,0 +1,147 @@
+#include "HullWhiteLattice.hpp"
+#include "HullWhiteAnalytics.hpp"
+#include "Counters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// times closer than this are the same grid time, as in hwTimeGrid
+static const double timeTolerance = 1.0e-10;
+
+std::vector<double> latticeTimeGrid(const std::vector<LatticeSwaption> &swaptions, double maxStep) {
+	std::vector<double> mandatory;
+	for (std::size_t k = 0; k < swaptions.size(); k++) {
+		mandatory.insert(mandatory.end(), swaptions[k].exerciseTimes.begin(), swaptions[k].exerciseTimes.end());
+		mandatory.insert(mandatory.end(), swaptions[k].payTimes.begin(), swaptions[k].payTimes.end());
+	}
+	return hwTimeGrid(mandatory, maxStep);
+}
+
+HullWhiteLattice::HullWhiteLattice(double a, double sigma, const std::vector<double> &times,
+	const std::vector<double> &discounts)
+	: times_(times), levels_(times.size()) {
+	if (times.size() < 2 || discounts.size() != times.size() || times[0] != 0.0)
+		throw std::runtime_error("the lattice needs a time grid from today and a discount factor for every time");
+
+	// today is the single node x = 0 with state price 1
+	levels_[0].dx = 0.0;
+	levels_[0].jMin = 0;
+	levels_[0].nodes.resize(1);
+	std::vector<double> statePrices(1, 1.0);
+	const double sqrt3 = std::sqrt(3.0);
+	for (std::size_t i = 0; i + 1 < times.size(); i++) {
+		Level &level = levels_[i], &next = levels_[i + 1];
+		double dt = times[i + 1] - times[i];
+		double v2 = sigma * sigma * (1.0 - std::exp(-2.0 * a * dt)) / (2.0 * a), v = std::sqrt(v2);
+		double decay = std::exp(-a * dt);
+		next.dx = v * sqrt3;
+
+		// branching like QuantLib's TrinomialTree: the middle child is the node nearest to the expected x
+		std::vector<long> middle(level.nodes.size());
+		long lowest = 0, highest = 0;
+		for (std::size_t j = 0; j < level.nodes.size(); j++) {
+			double x = (level.jMin + long(j)) * level.dx, m = x * decay;
+			long k = long(std::floor(m / next.dx + 0.5));
+			double e = m - k * next.dx, e2 = e * e, e3 = e * sqrt3;
+			Node &node = level.nodes[j];
+			node.down = (1.0 + e2 / v2 - e3 / v) / 6.0;
+			node.middle = (2.0 - e2 / v2) / 3.0;
+			node.up = (1.0 + e2 / v2 + e3 / v) / 6.0;
+			middle[j] = k;
+			lowest = (j == 0) ? k : std::min(lowest, k);
+			highest = (j == 0) ? k : std::max(highest, k);
+		}
+		next.jMin = lowest - 1;
+		next.nodes.resize(std::size_t(highest - lowest + 3));
+
+		// alpha of the step so the state prices reprice the curve's discount bond to the next time, then
+		// the state prices of the next level
+		double value = 0.0;
+		for (std::size_t j = 0; j < level.nodes.size(); j++)
+			value += statePrices[j] * std::exp(-(level.jMin + long(j)) * level.dx * dt);
+		double alpha = std::log(value / discounts[i + 1]) / dt;
+		std::vector<double> nextPrices(next.nodes.size(), 0.0);
+		for (std::size_t j = 0; j < level.nodes.size(); j++) {
+			Node &node = level.nodes[j];
+			node.branch = std::size_t(middle[j] - next.jMin);
+			node.discount = std::exp(-((level.jMin + long(j)) * level.dx + alpha) * dt);
+			double q = statePrices[j] * node.discount;
+			nextPrices[node.branch - 1] += q * node.down;
+			nextPrices[node.branch] += q * node.middle;
+			nextPrices[node.branch + 1] += q * node.up;
+		}
+		statePrices.swap(nextPrices);
+	}
+	COUNT("lattice builds", 1);
+}
+
+std::size_t HullWhiteLattice::timeIndex(double t) const {
+	std::vector<double>::const_iterator found = std::lower_bound(times_.begin(), times_.end(), t - timeTolerance);
+	if (found == times_.end() || std::fabs(*found - t) > timeTolerance)
+		throw std::runtime_error("swaption time not on the lattice grid");
+	return std::size_t(found - times_.begin());
+}
+
+std::vector<double> HullWhiteLattice::price(const std::vector<LatticeSwaption> &swaptions) const {
+	// what happens on every grid time: exercises first, then the coupons paid on it join the fixed leg, since a
+	// swap entered on a payment date only receives the coupons after it
+	struct Event {
+		std::size_t swaption;
+		bool exercise;
+		double coupon;
+	};
+	std::vector<std::vector<Event> > events(times_.size());
+	for (std::size_t q = 0; q < swaptions.size(); q++) {
+		const LatticeSwaption &s = swaptions[q];
+		for (std::size_t k = 0; k < s.exerciseTimes.size(); k++) {
+			Event e = { q, true, 0.0 };
+			events[timeIndex(s.exerciseTimes[k])].push_back(e);
+		}
+		for (std::size_t k = 0; k < s.payTimes.size(); k++) {
+			Event e = { q, false, s.coupons[k] };
+			events[timeIndex(s.payTimes[k])].push_back(e);
+		}
+	}
+	for (std::size_t i = 0; i < events.size(); i++)
+		std::stable_sort(events[i].begin(), events[i].end(),
+			[](const Event &x, const Event &y) { return x.exercise && !y.exercise; });
+
+	// a row per node: the swaption values, then the values of their fixed legs with the notional
+	std::size_t m = swaptions.size(), width = 2 * m;
+	auto apply = [&](std::size_t i, std::vector<double> &values) {
+		std::size_t nodes = levels_[i].nodes.size();
+		for (std::size_t e = 0; e < events[i].size(); e++) {
+			const Event &event = events[i][e];
+			std::size_t q = event.swaption;
+			double sign = swaptions[q].payer ? 1.0 : -1.0;
+			for (std::size_t j = 0; j < nodes; j++) {
+				double *row = &values[j * width];
+				if (event.exercise)
+					row[q] = std::max(row[q], sign * (1.0 - row[m + q]));
+				else
+					row[m + q] += event.coupon;
+			}
+		}
+	};
+
+	std::size_t last = times_.size() - 1;
+	std::vector<double> values(levels_[last].nodes.size() * width, 0.0), rolled;
+	apply(last, values);
+	for (std::size_t i = last; i-- > 0;) {
+		const Level &level = levels_[i];
+		rolled.assign(level.nodes.size() * width, 0.0);
+		for (std::size_t j = 0; j < level.nodes.size(); j++) {
+			const Node &node = level.nodes[j];
+			const double *down = &values[(node.branch - 1) * width];
+			const double *middle = down + width, *up = middle + width;
+			double pd = node.discount * node.down, pm = node.discount * node.middle, pu = node.discount * node.up;
+			double *row = &rolled[j * width];
+			for (std::size_t c = 0; c < width; c++)
+				row[c] = pd * down[c] + pm * middle[c] + pu * up[c];
+		}
+		values.swap(rolled);
+		apply(i, values);
+	}
+	COUNT("lattice swaptions", m);
+	return std::vector<double>(values.begin(), values.begin() + m);
+}
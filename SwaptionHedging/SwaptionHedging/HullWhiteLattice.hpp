@@ -0,0 +1,55 @@
+#ifndef     _HULLWHITELATTICE_HPP_
+# define    _HULLWHITELATTICE_HPP_
+
+#include <vector>
+
+// This file and HullWhiteLattice.cpp build one Hull-White trinomial tree for a calibrated model and date, the
+// same tree as QuantLib's HullWhite::tree (TrinomialTree on the OU factor, fitted to the curve step by step),
+// and price a whole set of European and Bermudan swaptions on it in one backward sweep. Every node carries the
+// values of all the swaptions next to each other, so the rollback of a node is one loop over a contiguous row,
+// which g++ vectorizes at -O3; TreeSwaptionEngine builds and rolls back a tree per swaption. SwaptionBenchmark
+// --engines times the price of a swaption against the number of swaptions on the lattice. //
+
+// a swaption on a unit notional, exercisable on every exercise time into the swap of the fixed leg payments after
+// it, the floating leg is worth par on the exercise date; one exercise time is a European
+struct LatticeSwaption {
+	std::vector<double> exerciseTimes;
+	std::vector<double> payTimes; // fixed leg payment times of the longest swap
+	std::vector<double> coupons; // strike * accrual, the last one includes the notional
+	bool payer;
+};
+
+// today, the exercise and payment times of all the swaptions, and steps of at most maxStep between them
+std::vector<double> latticeTimeGrid(const std::vector<LatticeSwaption> &swaptions, double maxStep);
+
+class HullWhiteLattice {
+public:
+	// discounts[i] = P(0, times[i]) of the curve, times[0] = 0
+	HullWhiteLattice(double a, double sigma, const std::vector<double> &times, const std::vector<double> &discounts);
+
+	// values today, every exercise and payment time must be on the grid
+	std::vector<double> price(const std::vector<LatticeSwaption> &swaptions) const;
+
+	const std::vector<double> &times() const { return times_; }
+	std::size_t size(std::size_t i) const { return levels_[i].nodes.size(); }
+
+private:
+	struct Node {
+		std::size_t branch; // middle child, index in the next level
+		double down; // probabilities of branch - 1, branch and branch + 1
+		double middle;
+		double up;
+		double discount; // exp(-r dt) of the node
+	};
+	struct Level {
+		double dx; // x = (jMin + index) * dx
+		long jMin;
+		std::vector<Node> nodes;
+	};
+	std::size_t timeIndex(double t) const;
+
+	std::vector<double> times_;
+	std::vector<Level> levels_; // the last one has nodes without children
+};
+
+#endif /*!_HULLWHITELATTICE_HPP_*/
@@ -0,0 +1,59 @@
+#ifndef     _LATENCYHISTOGRAM_HPP_
+# define    _LATENCYHISTOGRAM_HPP_
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// power of two buckets in microseconds: bucket 0 is below 1us, bucket k is [2^(k-1), 2^k) us
+class LatencyHistogram {
+public:
+	LatencyHistogram() : counts_(32, 0), count_(0), total_(0.0), min_(0.0), max_(0.0) {}
+
+	void add(double micros) {
+		std::size_t k = 0;
+		for (double limit = 1.0; micros >= limit && k + 1 < counts_.size(); limit *= 2.0)
+			k++;
+		counts_[k]++;
+		if (count_ == 0 || micros < min_) min_ = micros;
+		if (count_ == 0 || micros > max_) max_ = micros;
+		total_ += micros;
+		count_++;
+	}
+
+	std::size_t count() const { return count_; }
+	double mean() const { return count_ > 0 ? total_ / count_ : 0.0; }
+	double min() const { return min_; }
+	double max() const { return max_; }
+
+	// upper edge of the bucket holding the q-th quantile
+	double quantile(double q) const {
+		std::size_t rank = static_cast<std::size_t>(q * count_), seen = 0;
+		for (std::size_t k = 0; k < counts_.size(); k++) {
+			seen += counts_[k];
+			if (seen > rank)
+				return static_cast<double>(1UL << k);
+		}
+		return max_;
+	}
+
+	// one line per non-empty bucket: upper edge in us, count
+	void write(std::ostream &out) const {
+		out << "Latency (us)" << "," << "Count" << std::endl;
+		for (std::size_t k = 0; k < counts_.size(); k++)
+			if (counts_[k] > 0)
+				out << "<" << (1UL << k) << "," << counts_[k] << std::endl;
+	}
+
+private:
+	std::vector<std::size_t> counts_;
+	std::size_t count_;
+	double total_, min_, max_;
+};
+
+// microseconds elapsed since start
+inline double microsSince(const std::chrono::steady_clock::time_point &start) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif /*!_LATENCYHISTOGRAM_HPP_*/
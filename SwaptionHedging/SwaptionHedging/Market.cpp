@@ -0,0 +1,246 @@
+#include "Market.hpp"
+#include "StageTimer.hpp"
+#include "CountingEngine.hpp"
+#include "CachedJamshidianSwaptionEngine.hpp"
+#include "Arena.hpp"
+#include <cmath>
+
+using namespace QuantLib;
+using namespace std;
+
+vector<Period> curvePillars() {
+	vector<Period> pillars;
+	pillars.push_back(0 * Days); pillars.push_back(3 * Months);
+	pillars.push_back(5 * Months); pillars.push_back(8 * Months);
+	pillars.push_back(11 * Months); pillars.push_back(14 * Months);
+	pillars.push_back(17 * Months); pillars.push_back(20 * Months);
+	Integer years[] = { 2,3,4,5,6,7,8,9,10,11,12,15,20,25,30,40,50 };
+	for (Size i = 0; i < 17; i++)
+		pillars.push_back(years[i] * Years);
+	return pillars;
+}
+
+// the reference date follows the evaluation date without business day adjustment,
+// like the curves built from todaysDate in the original per-date code
+QuotedDiscountCurve::QuotedDiscountCurve(const vector<Period> &pillars,
+	const vector<Handle<Quote> > &discounts, const DayCounter &dayCounter)
+	: YieldTermStructure(0, NullCalendar(), dayCounter), pillars_(pillars), discounts_(discounts),
+	times_(pillars.size()), data_(pillars.size()), updates_(0) {
+	QL_REQUIRE(pillars_.size() == discounts_.size(), "one discount factor per pillar required");
+	for (Size i = 0; i < discounts_.size(); i++)
+		registerWith(discounts_[i]);
+}
+
+Date QuotedDiscountCurve::maxDate() const {
+	return referenceDate() + pillars_.back();
+}
+
+void QuotedDiscountCurve::update() {
+	updates_++;
+	COUNT("curve notifications", 1);
+	// marks the curve for recalculation and notifies the index, the helpers, the model and the instruments
+	LazyObject::update();
+	// the reference date part of TermStructure::update(), without notifying a second time
+	if (moving_)
+		updated_ = false;
+}
+
+void QuotedDiscountCurve::performCalculations() const {
+	COUNT("curve recalculations", 1);
+	Date today = referenceDate();
+	for (Size i = 0; i < pillars_.size(); i++) {
+		times_[i] = timeFromReference(today + pillars_[i]);
+		data_[i] = discounts_[i]->value();
+	}
+	QL_REQUIRE(data_[0] == 1.0, "the first discount factor must be 1.0");
+	HeapScope heap; // the interpolation lives as long as the curve, not the arena of the date
+	interpolation_ = Linear().interpolate(times_.begin(), times_.end(), data_.begin());
+	interpolation_.update();
+}
+
+DiscountFactor QuotedDiscountCurve::discountImpl(Time t) const {
+	calculate();
+	if (t <= times_.back())
+		return interpolation_(t, true);
+	// flat forward extrapolation, as InterpolatedDiscountCurve does
+	Time tMax = times_.back();
+	DiscountFactor dMax = data_.back();
+	Rate instFwdMax = -interpolation_.derivative(tMax) / dMax;
+	return dMax * std::exp(-instFwdMax * (t - tMax));
+}
+
+Market::Market(const Date &today, const vector<DiscountFactor> &dfs, const vector<Volatility> &vols, Real tolerance)
+	: basketChanged_(false), tolerance_(tolerance), fittedError_(0.0), quoteChanges_(0), curveChanges_(0) {
+	Settings::instance().evaluationDate() = today;
+
+	// one quote per curve pillar, the curve is built once and relinked never
+	vector<Handle<Quote> > discounts;
+	for (Size i = 0; i < dfs.size(); i++) {
+		discounts_.push_back(boost::shared_ptr<SimpleQuote>(new SimpleQuote(dfs[i])));
+		discounts.push_back(Handle<Quote>(discounts_.back()));
+	}
+	curve_ = boost::shared_ptr<QuotedDiscountCurve>(
+		new QuotedDiscountCurve(curvePillars(), discounts, EURLibor1M().dayCounter()));
+	termStructure_.linkTo(curve_);
+	index_ = boost::shared_ptr<IborIndex>(new Euribor3M(termStructure_));
+
+	// one quote per cell of the 10x10 surface, the co-terminal diagonal is the calibration basket
+	for (Size k = 0; k < vols.size(); k++)
+		vols_.push_back(boost::shared_ptr<SimpleQuote>(new SimpleQuote(vols[k])));
+	model_ = boost::shared_ptr<HullWhite>(new HullWhite(termStructure_));
+	calibrationStart_ = model_->params();
+	modelCounter_.registerWith(model_);
+	boost::shared_ptr<PricingEngine> engine = countingEngine(
+		boost::shared_ptr<PricingEngine>(new CachedJamshidianSwaptionEngine(model_)), "calibration engine calculations");
+	for (Size i = 0; i < 10; i++) {
+		Size j = 10 - i - 1;
+		helpers_.push_back(boost::shared_ptr<CalibrationHelper>(new
+			SwaptionHelper(Period(i + 1, Years),
+				Period(j + 1, Years),
+				Handle<Quote>(vols_[i * 10 + j]),
+				index_,
+				index_->tenor(),
+				index_->dayCounter(),
+				index_->dayCounter(),
+				termStructure_)));
+		helpers_.back()->setPricingEngine(engine);
+	}
+	calibrate();
+}
+
+void Market::setEvaluationDate(const Date &today) {
+	if (today == Settings::instance().evaluationDate())
+		return;
+	Settings::instance().evaluationDate() = today; // the curve pillars move with it
+	basketChanged_ = true;
+	quoteChanges_++;
+	curveChanges_++;
+}
+
+void Market::setDiscountFactor(Size pillar, DiscountFactor df) {
+	QL_REQUIRE(pillar >= 1 && pillar < discounts_.size(), "discount factor pillar " << pillar << " out of range");
+	if (discounts_[pillar]->setValue(df) != 0.0) {
+		basketChanged_ = true;
+		quoteChanges_++;
+		curveChanges_++;
+	}
+}
+
+void Market::setVolatility(Size expiry, Size tenor, Volatility vol) {
+	QL_REQUIRE(expiry >= 1 && expiry <= 10 && tenor >= 1 && tenor <= 10,
+		"no quote for " << expiry << "x" << tenor);
+	// notifies the helper watching this quote, if any
+	if (vols_[(expiry - 1) * 10 + (tenor - 1)]->setValue(vol) == 0.0)
+		return;
+	quoteChanges_++;
+	if (expiry + tenor == 11)
+		basketChanged_ = true;
+}
+
+void Market::setMarket(const Date &today, const vector<DiscountFactor> &dfs, const vector<Volatility> &vols) {
+	QL_REQUIRE(dfs.size() == discounts_.size() && vols.size() == vols_.size(), "wrong number of quotes");
+	setEvaluationDate(today);
+	for (Size i = 1; i < dfs.size(); i++)
+		setDiscountFactor(i, dfs[i]);
+	for (Size k = 0; k < vols.size(); k++)
+		setVolatility(k / 10 + 1, k % 10 + 1, vols[k]);
+}
+
+bool Market::refresh(bool forceCalibration) {
+	if (!basketChanged_ && !forceCalibration)
+		return false;
+	basketChanged_ = false;
+	{
+		ScopedStage stage("curve");
+		termStructure_->discount(0.0); // rebuilds the interpolation here rather than inside the first price
+	}
+	Real error;
+	{
+		// the helpers rebuild their swaptions here, with the legs, coupons and observer registrations on the curve
+		// and index, and keep them until the next date; they come from the heap rather than the arena of this one
+		HeapScope heap;
+		error = calibrationError();
+	}
+	if (forceCalibration || error > fittedError_ + tolerance_) {
+		calibrate();
+		return true;
+	}
+	return false;
+}
+
+void Market::calibrate() {
+	ScopedStage stage("calibration");
+	model_->setParams(calibrationStart_);
+	Size evaluations = modelCounter_.count(); // the model notifies once per set of trial parameters
+	LevenbergMarquardt om;
+	model_->calibrate(helpers_, om,
+		EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+	fittedError_ = calibrationError();
+	stage.arg("function evaluations", Real(modelCounter_.count() - evaluations));
+	COUNT("calibrations", 1);
+	COUNT("calibration evaluations", modelCounter_.count() - evaluations);
+	stage.arg("end criteria", Real(model_->endCriteria()));
+	stage.arg("rms error", fittedError_);
+	basketChanged_ = false;
+}
+
+void Market::setModelParams(const Array &params) {
+	model_->setParams(params);
+	fittedError_ = calibrationError();
+	basketChanged_ = false;
+}
+
+Real Market::calibrationError() const {
+	Real sum = 0.0;
+	for (Size i = 0; i < helpers_.size(); i++) {
+		Real e = helpers_[i]->calibrationError();
+		sum += e * e;
+	}
+	return std::sqrt(sum / helpers_.size());
+}
+
+MarketNotifications Market::notifications() const {
+	MarketNotifications n = { quoteChanges_, curveChanges_, curve_->updates(), modelCounter_.count() };
+	return n;
+}
+
+MarketTransaction::MarketTransaction(Market &market)
+	: market_(market), owner_(ObservableSettings::instance().updatesEnabled()), open_(true),
+	start_(market.notifications()), end_(start_) {
+	if (owner_)
+		ObservableSettings::instance().disableUpdates(true); // deferred, not dropped
+}
+
+MarketTransaction::~MarketTransaction() {
+	try {
+		if (open_)
+			release();
+	} catch (...) {}
+}
+
+void MarketTransaction::release() {
+	open_ = false;
+	if (owner_)
+		ObservableSettings::instance().enableUpdates(); // every deferred observer is updated once
+	end_ = market_.notifications();
+}
+
+bool MarketTransaction::commit(bool forceCalibration) {
+	QL_REQUIRE(open_, "market transaction already committed");
+	release();
+	bool recalibrated = market_.refresh(forceCalibration);
+	end_ = market_.notifications();
+	return recalibrated;
+}
+
+MarketNotifications MarketTransaction::notifications() const {
+	MarketNotifications end = open_ ? market_.notifications() : end_;
+	MarketNotifications n = { end.quoteChanges - start_.quoteChanges, end.curveChanges - start_.curveChanges,
+		end.curveUpdates - start_.curveUpdates, end.modelUpdates - start_.modelUpdates };
+	return n;
+}
+
+Size MarketTransaction::avoided() const {
+	MarketNotifications n = notifications();
+	return n.curveChanges > n.curveUpdates ? n.curveChanges - n.curveUpdates : 0;
+}
@@ -0,0 +1,118 @@
+#ifndef     _MARKET_HPP_
+# define    _MARKET_HPP_
+
+#include <ql/quantlib.hpp>
+#include <vector>
+#include "CountingEngine.hpp"
+
+// This file and Market.cpp keep the curve, the swaption vol quotes, the calibration basket and the
+// Hull-White model alive between market updates. The object graph is built once; a new date only moves
+// the evaluation date and sets quote values, and the lazy objects recompute whatever depends on them. //
+
+// 25 discount factor pillars, the first one is today with discount factor 1.0
+std::vector<QuantLib::Period> curvePillars();
+
+// linear discount curve on quoted discount factors at pillars relative to the evaluation date,
+// recalculated lazily when a quote or the evaluation date changes
+class QuotedDiscountCurve : public QuantLib::YieldTermStructure, public QuantLib::LazyObject {
+public:
+	QuotedDiscountCurve(const std::vector<QuantLib::Period> &pillars,
+		const std::vector<QuantLib::Handle<QuantLib::Quote> > &discounts,
+		const QuantLib::DayCounter &dayCounter);
+	QuantLib::Date maxDate() const;
+	void update();
+	QuantLib::Size updates() const { return updates_; } // notifications received from quotes and the evaluation date
+
+protected:
+	QuantLib::DiscountFactor discountImpl(QuantLib::Time t) const;
+
+private:
+	void performCalculations() const;
+	std::vector<QuantLib::Period> pillars_;
+	std::vector<QuantLib::Handle<QuantLib::Quote> > discounts_;
+	mutable std::vector<QuantLib::Time> times_;
+	mutable std::vector<QuantLib::Real> data_;
+	mutable QuantLib::Interpolation interpolation_;
+	QuantLib::Size updates_;
+};
+
+struct MarketNotifications {
+	QuantLib::Size quoteChanges; // quotes set to a new value, including the evaluation date
+	QuantLib::Size curveChanges; // discount factor and date changes, each one notifies the curve right away unless deferred
+	QuantLib::Size curveUpdates; // notifications the curve actually received
+	QuantLib::Size modelUpdates; // notifications the model sent on to the engines and instruments
+};
+
+class Market {
+public:
+	// dfs as read by DiscountFactorVec, vols as read by ImpliedVolatilityVec (10x10, 1-10Yr expiry and tenor)
+	Market(const QuantLib::Date &today,
+		const std::vector<QuantLib::DiscountFactor> &dfs,
+		const std::vector<QuantLib::Volatility> &vols,
+		QuantLib::Real tolerance = 1.0e-3);
+
+	void setEvaluationDate(const QuantLib::Date &today);
+	void setDiscountFactor(QuantLib::Size pillar, QuantLib::DiscountFactor df); // pillar 1..24
+	void setVolatility(QuantLib::Size expiry, QuantLib::Size tenor, QuantLib::Volatility vol); // years 1..10
+	// move to a new date with a whole new set of quotes
+	void setMarket(const QuantLib::Date &today,
+		const std::vector<QuantLib::DiscountFactor> &dfs,
+		const std::vector<QuantLib::Volatility> &vols);
+
+	// recalibrate after quote changes, only if the model misses the calibration basket by more than
+	// the tolerance unless forced; returns true if recalibrated
+	bool refresh(bool forceCalibration = false);
+	// every calibration starts from calibrationStart(), by default the parameters of a new HullWhite (a = 0.1,
+	// sigma = 0.01) as the per-date rebuild did, so the result of a date does not depend on the dates calibrated before it
+	void calibrate();
+	const QuantLib::Array &calibrationStart() const { return calibrationStart_; }
+	void setCalibrationStart(const QuantLib::Array &params) { calibrationStart_ = params; }
+	// puts back parameters calibrated before on the quotes they were calibrated to, without calibrating
+	void setModelParams(const QuantLib::Array &params);
+	QuantLib::Real calibrationError() const; // rms relative price error of the calibration basket
+
+	QuantLib::Date today() const { return QuantLib::Settings::instance().evaluationDate(); }
+	QuantLib::Handle<QuantLib::YieldTermStructure> termStructure() const { return termStructure_; }
+	const boost::shared_ptr<QuantLib::IborIndex> &index() const { return index_; }
+	const boost::shared_ptr<QuantLib::HullWhite> &model() const { return model_; }
+	MarketNotifications notifications() const; // since construction
+
+private:
+	std::vector<boost::shared_ptr<QuantLib::SimpleQuote> > discounts_;
+	boost::shared_ptr<QuotedDiscountCurve> curve_;
+	QuantLib::RelinkableHandle<QuantLib::YieldTermStructure> termStructure_;
+	boost::shared_ptr<QuantLib::IborIndex> index_;
+	std::vector<boost::shared_ptr<QuantLib::SimpleQuote> > vols_;
+	std::vector<boost::shared_ptr<QuantLib::CalibrationHelper> > helpers_;
+	boost::shared_ptr<QuantLib::HullWhite> model_;
+	QuantLib::Array calibrationStart_;
+	bool basketChanged_;
+	QuantLib::Real tolerance_;
+	QuantLib::Real fittedError_; // basket error right after the last calibration
+	QuantLib::Size quoteChanges_;
+	QuantLib::Size curveChanges_;
+	NotificationCounter modelCounter_;
+};
+
+// a batch of market updates: notifications of quotes changed while it is open are held back by
+// ObservableSettings and delivered once per observer on commit, followed by one refresh of the market
+class MarketTransaction {
+public:
+	explicit MarketTransaction(Market &market);
+	~MarketTransaction(); // delivers the notifications without refreshing if not committed
+	bool commit(bool forceCalibration = false); // returns true if the model was recalibrated
+	MarketNotifications notifications() const; // during the transaction, up to the commit
+	QuantLib::Size avoided() const; // curve notifications saved by the batch
+
+private:
+	MarketTransaction(const MarketTransaction &);
+	MarketTransaction &operator=(const MarketTransaction &);
+	void release();
+	Market &market_;
+	bool owner_; // false inside another transaction, which then delivers the notifications
+	bool open_;
+	MarketNotifications start_;
+	MarketNotifications end_;
+};
+
+#endif /*!_MARKET_HPP_*/
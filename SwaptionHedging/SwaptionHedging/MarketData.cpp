@@ -0,0 +1,56 @@
+#include "MarketData.hpp"
+#include "CSVparser.hpp"
+#include "StageTimer.hpp"
+#include <iomanip>
+#include <sstream>
+
+using namespace QuantLib;
+using namespace std;
+
+// read discount factors from files like "DF_20080701.csv"
+vector <double> DiscountFactorVec(const string &filename) {
+	Parser data = Parser(filename); // from CSVParser
+	vector <double> result;
+	result.push_back(1.0); // QuantLib requires the first discount factor must be 1.0
+	for (int i = 0; i < data.rowCount(); i++)
+	result.push_back(stod(data[i]["Discount"])); 
+	return result;
+} 
+
+// read implied volatilities surface from files like "IV_20080701.csv"
+vector <double> ImpliedVolatilityVec(const string &filename) {
+	Parser data = Parser(filename);
+	vector <double> result;
+	// considering the liquitity, only use swaptions with 1-10 Yr maturities and tenors
+	for (int i = 4; i <= 13; i++) {
+		for (int j = 1; j <= 10; j++)
+			result.push_back(stod(data[i][j])/100);
+	}
+	return result;
+} 
+
+// the "DF_" and "IV_" files of a date, like "DF_20080701.csv"
+MarketQuotes readMarketQuotes(const string &dateString) {
+	ScopedStage stage("load", dateString);
+	MarketQuotes quotes;
+	quotes.dfs = DiscountFactorVec("DF_" + dateString + ".csv");
+	quotes.vols = ImpliedVolatilityVec("IV_" + dateString + ".csv");
+	return quotes;
+}
+
+// move the market to a new date with the quotes of its files
+void loadMarket(Market &market, const string &dateString, Date todaysDate) {
+	MarketQuotes quotes = readMarketQuotes(dateString);
+	market.setMarket(todaysDate, quotes.dfs, quotes.vols);
+}
+
+// construct strings like "20080701" from a date
+string dateToString(const Date &d) {
+	std::ostringstream out;
+	out << d.year() << setw(2) << setfill('0') << int(d.month()) << setw(2) << setfill('0') << d.dayOfMonth();
+	return out.str();
+}
+
+Date stringToDate(const string &s) {
+	return Date(stoi(s.substr(6, 2)), Month(stoi(s.substr(4, 2))), stoi(s.substr(0, 4)));
+}
@@ -0,0 +1,30 @@
+#ifndef     _MARKETDATA_HPP_
+# define    _MARKETDATA_HPP_
+
+#include "Market.hpp"
+#include <string>
+#include <vector>
+
+// This file and MarketData.cpp read the daily market data files, DF_yyyymmdd.csv and IV_yyyymmdd.csv //
+
+// discount factors of the curve pillars, with the 1.0 of today in front
+std::vector<double> DiscountFactorVec(const std::string &filename);
+
+// 10x10 surface of 1-10Yr expiries and tenors, row by row
+std::vector<double> ImpliedVolatilityVec(const std::string &filename);
+
+// quotes of one date's files, read without touching QuantLib so loaders can run on other threads
+struct MarketQuotes {
+	std::vector<QuantLib::DiscountFactor> dfs;
+	std::vector<QuantLib::Volatility> vols;
+};
+MarketQuotes readMarketQuotes(const std::string &dateString);
+
+// move the market to a new date with the quotes of its files
+void loadMarket(Market &market, const std::string &dateString, QuantLib::Date todaysDate);
+
+// dates in file names like "20080701"
+std::string dateToString(const QuantLib::Date &d);
+QuantLib::Date stringToDate(const std::string &s);
+
+#endif /*!_MARKETDATA_HPP_*/
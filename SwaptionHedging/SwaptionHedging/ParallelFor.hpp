@@ -0,0 +1,33 @@
+#ifndef     _PARALLELFOR_HPP_
+# define    _PARALLELFOR_HPP_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// run f(i) for i = 0..n-1 on a few threads, the next index is taken from a shared counter
+// so threads that get cheap items simply take more of them
+inline unsigned int defaultThreadCount() {
+	unsigned int n = std::thread::hardware_concurrency();
+	return n == 0 ? 1 : n;
+}
+
+template <class F>
+void parallelFor(std::size_t n, unsigned int threads, const F &f) {
+	if (threads <= 1 || n <= 1) {
+		for (std::size_t i = 0; i < n; i++)
+			f(i);
+		return;
+	}
+	std::atomic<std::size_t> next(0);
+	std::vector<std::thread> workers;
+	for (unsigned int k = 0; k < threads; k++)
+		workers.push_back(std::thread([&]() {
+			for (std::size_t i = next++; i < n; i = next++)
+				f(i);
+		}));
+	for (std::size_t k = 0; k < workers.size(); k++)
+		workers[k].join();
+}
+
+#endif /*!_PARALLELFOR_HPP_*/
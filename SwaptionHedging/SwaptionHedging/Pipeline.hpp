@@ -0,0 +1,221 @@
+#ifndef     _PIPELINE_HPP_
+# define    _PIPELINE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// This file runs a sequence of items (the dates of a backtest) through a chain of stages, every stage on its
+// own threads with a bounded queue in front of it, so a date is loaded while the previous one is calibrated and
+// the one before is written. Each stage has a number of workers; an ordered stage has one worker and sees the
+// items in sequence whatever order the stage before finishes them in. Throughput is bounded by the slowest
+// stage instead of the sum of all. The first exception thrown by a stage stops the pipeline and is rethrown
+// by run(). //
+
+// a queue of at most capacity items, push blocks while it is full and pop while it is empty
+template <class T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(std::size_t capacity) : capacity_(capacity == 0 ? 1 : capacity), closed_(false) {}
+
+	// false if the queue was closed, the item is dropped then
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		notFull_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+		if (closed_)
+			return false;
+		items_.push_back(std::move(item));
+		notEmpty_.notify_one();
+		return true;
+	}
+	// false once the queue is closed and drained
+	bool pop(T &item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		notEmpty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+		if (items_.empty())
+			return false;
+		item = std::move(items_.front());
+		items_.pop_front();
+		notFull_.notify_one();
+		return true;
+	}
+	// no more pushes, pops return what is left
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+		notEmpty_.notify_all();
+		notFull_.notify_all();
+	}
+	// close and drop what is left, after a failure
+	void abort() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+		items_.clear();
+		notEmpty_.notify_all();
+		notFull_.notify_all();
+	}
+
+private:
+	std::size_t capacity_;
+	bool closed_;
+	std::deque<T> items_;
+	std::mutex mutex_;
+	std::condition_variable notEmpty_;
+	std::condition_variable notFull_;
+};
+
+struct PipelineStageStats {
+	std::string name;
+	unsigned int workers;
+	std::size_t items;
+	double busySeconds; // summed over the workers
+};
+
+template <class Item>
+class Pipeline {
+public:
+	typedef std::function<void(Item &)> StageFunction;
+
+	explicit Pipeline(std::size_t capacity = 4) : capacity_(capacity) {}
+
+	void addStage(const std::string &name, unsigned int workers, const StageFunction &f, bool ordered = false) {
+		if (ordered && workers != 1)
+			throw std::invalid_argument("ordered stage " + name + " must have one worker");
+		Stage stage = { name, workers == 0 ? 1 : workers, ordered, f };
+		stages_.push_back(stage);
+	}
+
+	// make(i) creates item i on the calling thread, items enter the first stage in order of i
+	void run(std::size_t n, const std::function<Item(std::size_t)> &make) {
+		std::vector<std::unique_ptr<BoundedQueue<Task> > > queues;
+		for (std::size_t s = 0; s <= stages_.size(); s++) // the last one is drained here
+			queues.push_back(std::unique_ptr<BoundedQueue<Task> >(new BoundedQueue<Task>(capacity_)));
+		stats_.clear();
+		for (std::size_t s = 0; s < stages_.size(); s++) {
+			PipelineStageStats stats = { stages_[s].name, stages_[s].workers, 0, 0.0 };
+			stats_.push_back(stats);
+		}
+		error_ = std::exception_ptr();
+
+		std::vector<std::thread> threads;
+		std::vector<std::size_t> running(stages_.size());
+		for (std::size_t s = 0; s < stages_.size(); s++) {
+			running[s] = stages_[s].workers;
+			for (unsigned int w = 0; w < stages_[s].workers; w++)
+				threads.push_back(std::thread([&, s]() {
+					work(s, *queues[s], *queues[s + 1], queues);
+					std::lock_guard<std::mutex> lock(mutex_);
+					if (--running[s] == 0)
+						queues[s + 1]->close(); // the last worker of a stage closes its output
+				}));
+		}
+		threads.push_back(std::thread([&]() { // drain the end of the chain
+			Task task;
+			while (queues.back()->pop(task)) {}
+		}));
+
+		for (std::size_t i = 0; i < n; i++) {
+			Task task;
+			task.sequence = i;
+			try {
+				task.item = make(i);
+			}
+			catch (...) {
+				fail(std::current_exception(), queues);
+				break;
+			}
+			if (!queues[0]->push(std::move(task)))
+				break;
+		}
+		queues[0]->close();
+		for (std::size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+		if (error_)
+			std::rethrow_exception(error_);
+	}
+
+	const std::vector<PipelineStageStats> &stats() const { return stats_; }
+
+private:
+	struct Stage {
+		std::string name;
+		unsigned int workers;
+		bool ordered;
+		StageFunction f;
+	};
+	struct Task {
+		std::size_t sequence;
+		Item item;
+	};
+
+	void fail(std::exception_ptr error, std::vector<std::unique_ptr<BoundedQueue<Task> > > &queues) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!error_)
+			error_ = error;
+		for (std::size_t q = 0; q < queues.size(); q++)
+			queues[q]->abort();
+	}
+
+	// false after a failure
+	bool process(std::size_t s, Task &task, BoundedQueue<Task> &out,
+		std::vector<std::unique_ptr<BoundedQueue<Task> > > &queues) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		try {
+			stages_[s].f(task.item);
+		}
+		catch (...) {
+			fail(std::current_exception(), queues);
+			return false;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stats_[s].items++;
+			stats_[s].busySeconds += seconds;
+		}
+		return out.push(std::move(task));
+	}
+
+	void work(std::size_t s, BoundedQueue<Task> &in, BoundedQueue<Task> &out,
+		std::vector<std::unique_ptr<BoundedQueue<Task> > > &queues) {
+		Task task;
+		if (!stages_[s].ordered) {
+			while (in.pop(task))
+				if (!process(s, task, out, queues))
+					return;
+			return;
+		}
+		// items that overtook the next one in sequence wait here, the queues in front stay bounded
+		std::map<std::size_t, Task> waiting;
+		std::size_t next = 0;
+		while (in.pop(task)) {
+			waiting.insert(std::make_pair(task.sequence, std::move(task)));
+			for (typename std::map<std::size_t, Task>::iterator it = waiting.find(next); it != waiting.end();
+				it = waiting.find(next)) {
+				Task ready = std::move(it->second);
+				waiting.erase(it);
+				if (!process(s, ready, out, queues))
+					return;
+				next++;
+			}
+		}
+	}
+
+	std::size_t capacity_;
+	std::vector<Stage> stages_;
+	std::vector<PipelineStageStats> stats_;
+	std::mutex mutex_;
+	std::exception_ptr error_;
+};
+
+#endif /*!_PIPELINE_HPP_*/
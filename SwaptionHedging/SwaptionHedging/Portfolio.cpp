@@ -0,0 +1,241 @@
+#include "Portfolio.hpp"
+#include "CSVparser.hpp"
+#include "StageTimer.hpp"
+#include "CountingEngine.hpp"
+#include "ScheduleCache.hpp"
+#include "BitmapCalendar.hpp"
+#include "CachedJamshidianSwaptionEngine.hpp"
+#include <cmath>
+
+using namespace QuantLib;
+
+// dates in the portfolio file are written like "20080701"
+static Date parseDate(const string &s) {
+	QL_REQUIRE(s.size() == 8, "bad date " << s << " in portfolio file");
+	return Date(stoi(s.substr(6, 2)), Month(stoi(s.substr(4, 2))), stoi(s.substr(0, 4)));
+}
+
+const BitmapCalendar &targetCalendar() {
+	static const BitmapCalendar calendar(TARGET(), 1990, 2100);
+	return calendar;
+}
+
+Date swapStartDate(const Date &settlement, Integer maturity) {
+	return targetCalendar().advance(settlement, maturity, Years, ModifiedFollowing);
+}
+
+boost::shared_ptr<const CachedSchedule> fixedLeg(const Date &settlement, Integer maturity, Integer tenor,
+	const DayCounter &timeDayCounter) {
+	const BitmapCalendar &calendar = targetCalendar();
+	Date startDate = swapStartDate(settlement, maturity); // swaption maturity
+	Date endDate = calendar.advance(startDate, tenor, Years, ModifiedFollowing); // end of underlying swap
+	return ScheduleCache::instance().schedule(startDate, endDate, Semiannual, calendar, Unadjusted,
+		fixedLegDayCounter(), timeDayCounter);
+}
+
+boost::shared_ptr<const CachedSchedule> floatingLeg(const Date &settlement, Integer maturity, Integer tenor,
+	const DayCounter &accrualDayCounter, const DayCounter &timeDayCounter) {
+	const BitmapCalendar &calendar = targetCalendar();
+	Date startDate = swapStartDate(settlement, maturity);
+	Date endDate = calendar.advance(startDate, tenor, Years, ModifiedFollowing);
+	return ScheduleCache::instance().schedule(startDate, endDate, Quarterly, calendar, ModifiedFollowing,
+		accrualDayCounter, timeDayCounter);
+}
+
+Schedule fixedLegSchedule(const Date &settlement, Integer maturity, Integer tenor) {
+	return fixedLeg(settlement, maturity, tenor, Actual360())->schedule;
+}
+
+Schedule floatingLegSchedule(const Date &settlement, Integer maturity, Integer tenor) {
+	return floatingLeg(settlement, maturity, tenor, Actual360(), Actual360())->schedule;
+}
+
+DayCounter fixedLegDayCounter() {
+	return Thirty360(Thirty360::European);
+}
+
+vector<Position> readPortfolio(const string &filename) {
+	Parser data = Parser(filename); // from CSVParser
+	vector<Position> result;
+	for (unsigned int i = 0; i < data.rowCount(); i++) {
+		Position p;
+		p.id = data[i]["Id"];
+		string instrument = data[i]["Instrument"];
+		QL_REQUIRE(instrument == "Swaption" || instrument == "Swap",
+			"unknown instrument " << instrument << " for position " << p.id);
+		p.isSwaption = (instrument == "Swaption");
+		string type = data[i]["Type"];
+		QL_REQUIRE(type == "Payer" || type == "Receiver",
+			"unknown type " << type << " for position " << p.id);
+		p.type = (type == "Payer") ? VanillaSwap::Payer : VanillaSwap::Receiver;
+		p.notional = stod(data[i]["Notional"]);
+		p.settlement = parseDate(data[i]["Settlement"]);
+		p.maturity = stoi(data[i]["Maturity"]);
+		p.tenor = stoi(data[i]["Tenor"]);
+		p.strike = stod(data[i]["Strike"]);
+		result.push_back(p);
+	}
+	return result;
+}
+
+vector<ScheduleGroup> groupPositions(const vector<Position> &positions) {
+	vector<ScheduleGroup> groups;
+	for (Size n = 0; n < positions.size(); n++) {
+		const Position &p = positions[n];
+
+		// find the group with the same schedule, or start a new one
+		Size g = 0;
+		while (g < groups.size() && !(groups[g].settlement == p.settlement
+			&& groups[g].maturity == p.maturity && groups[g].tenor == p.tenor))
+			g++;
+		if (g == groups.size()) {
+			ScheduleGroup group;
+			group.settlement = p.settlement;
+			group.maturity = p.maturity;
+			group.tenor = p.tenor;
+			groups.push_back(group);
+		}
+
+		if (!p.isSwaption) {
+			groups[g].swaps.push_back(n);
+			continue;
+		}
+		vector<StrikeBucket> &buckets = groups[g].swaptions;
+		Size b = 0;
+		while (b < buckets.size() && !(buckets[b].type == p.type && buckets[b].strike == p.strike))
+			b++;
+		if (b == buckets.size()) {
+			StrikeBucket bucket;
+			bucket.type = p.type;
+			bucket.strike = p.strike;
+			buckets.push_back(bucket);
+		}
+		buckets[b].positions.push_back(n);
+	}
+	return groups;
+}
+
+PositionValue swaptionGreeks(const Swaption &swaption, VanillaSwap::Type type, Rate strike,
+	Rate forward, Real annuity, const Date &exerciseDate,
+	const Handle<YieldTermStructure> &termStructure) {
+	PositionValue result = { swaption.NPV(), 0.0, 0.0 };
+
+	// delta and vega in black-76 based on the Hull-White price
+	Time T = Actual365Fixed().yearFraction(Settings::instance().evaluationDate(), exerciseDate); // same time as BlackSwaptionEngine
+	if (T > 0.0 && result.value > 0.0) {
+		ScopedStage stage("implied vol");
+		COUNT("implied vol solves", 1);
+		Volatility IV = swaption.impliedVolatility(result.value, termStructure, 0.05);
+		Real stdDev = IV * std::sqrt(T);
+		Real d1 = (std::log(forward / strike) + 0.5 * stdDev * stdDev) / stdDev;
+		CumulativeNormalDistribution N;
+		Real delta = (type == VanillaSwap::Payer) ? annuity * N(d1) : -annuity * N(-d1);
+		Real vega = annuity * forward * NormalDistribution()(d1) * std::sqrt(T);
+		result.delta = delta * 1.0e-4;
+		result.vega = vega * 0.01;
+	}
+	return result;
+}
+
+PortfolioPricer::PortfolioPricer(const vector<Position> &positions,
+	const Handle<YieldTermStructure> &termStructure,
+	const boost::shared_ptr<IborIndex> &index,
+	const boost::shared_ptr<HullWhite> &model)
+	: positions_(positions), groups_(groupPositions(positions)), termStructure_(termStructure) {
+
+	// all swaptions share one engine and therefore one calibrated model
+	boost::shared_ptr<PricingEngine> swapEngine = countingEngine(
+		boost::shared_ptr<PricingEngine>(new DiscountingSwapEngine(termStructure)), "swap engine calculations");
+	boost::shared_ptr<PricingEngine> swaptionEngine = countingEngine(
+		boost::shared_ptr<PricingEngine>(new CachedJamshidianSwaptionEngine(model)), "swaption engine calculations");
+
+	for (Size g = 0; g < groups_.size(); g++) {
+		const ScheduleGroup &group = groups_[g];
+		GroupInstruments instruments;
+		instruments.startDate = swapStartDate(group.settlement, group.maturity);
+		Schedule fixedSchedule = fixedLegSchedule(group.settlement, group.maturity, group.tenor);
+		Schedule floatSchedule = floatingLegSchedule(group.settlement, group.maturity, group.tenor);
+
+		// unit payer swap paying no fixed rate, any strike is priced off its two legs
+		instruments.unitSwap = boost::shared_ptr<VanillaSwap>(new VanillaSwap(
+			VanillaSwap::Payer, 1.0,
+			fixedSchedule, 0.0, fixedLegDayCounter(),
+			floatSchedule, index, 0.0,
+			index->dayCounter()));
+		instruments.unitSwap->setPricingEngine(swapEngine);
+
+		// one swaption per distinct type and strike
+		boost::shared_ptr<Exercise> europeanExercise(new EuropeanExercise(instruments.startDate));
+		for (Size b = 0; b < group.swaptions.size(); b++) {
+			const StrikeBucket &bucket = group.swaptions[b];
+			boost::shared_ptr<VanillaSwap> swap(new VanillaSwap(
+				bucket.type, 1.0,
+				fixedSchedule, bucket.strike, fixedLegDayCounter(),
+				floatSchedule, index, 0.0,
+				index->dayCounter()));
+			swap->setPricingEngine(swapEngine);
+			boost::shared_ptr<Swaption> swaption(new Swaption(swap, europeanExercise));
+			swaption->setPricingEngine(swaptionEngine);
+			instruments.swaptions.push_back(swaption);
+		}
+		instruments_.push_back(instruments);
+	}
+}
+
+PortfolioValue PortfolioPricer::value() const {
+	ScopedStage stage("pricing");
+	PortfolioValue result;
+	result.swaptionValue = result.swapValue = result.value = 0.0;
+	result.delta = result.vega = 0.0;
+	PositionValue zero = { 0.0, 0.0, 0.0 };
+	result.positions.assign(positions_.size(), zero);
+
+	for (Size g = 0; g < groups_.size(); g++) {
+		const ScheduleGroup &group = groups_[g];
+		const GroupInstruments &instruments = instruments_[g];
+		Real floatingNPV = instruments.unitSwap->floatingLegNPV();
+		Real annuity = -instruments.unitSwap->fixedLegBPS() / 1.0e-4;
+		Rate forward = floatingNPV / annuity;
+
+		// hedge swaps are linear in the strike, no instrument needed
+		for (Size s = 0; s < group.swaps.size(); s++) {
+			const Position &p = positions_[group.swaps[s]];
+			Real sign = (p.type == VanillaSwap::Payer) ? 1.0 : -1.0;
+			PositionValue &v = result.positions[group.swaps[s]];
+			v.value = p.notional * sign * (floatingNPV - p.strike * annuity);
+			v.delta = p.notional * sign * annuity * 1.0e-4;
+			v.vega = 0.0;
+			result.swapValue += v.value;
+		}
+
+		for (Size b = 0; b < group.swaptions.size(); b++) {
+			const StrikeBucket &bucket = group.swaptions[b];
+			ScopedStage bucketStage("swaption", positions_[bucket.positions[0]].id);
+			PositionValue unit = swaptionGreeks(*instruments.swaptions[b], bucket.type, bucket.strike,
+				forward, annuity, instruments.startDate, termStructure_);
+
+			for (Size k = 0; k < bucket.positions.size(); k++) {
+				const Position &p = positions_[bucket.positions[k]];
+				PositionValue &v = result.positions[bucket.positions[k]];
+				v.value = p.notional * unit.value;
+				v.delta = p.notional * unit.delta;
+				v.vega = p.notional * unit.vega;
+				result.swaptionValue += v.value;
+			}
+		}
+	}
+
+	for (Size k = 0; k < result.positions.size(); k++) {
+		result.delta += result.positions[k].delta;
+		result.vega += result.positions[k].vega;
+	}
+	result.value = result.swaptionValue + result.swapValue;
+	return result;
+}
+
+PortfolioValue valuePortfolio(const vector<Position> &positions,
+	const Handle<YieldTermStructure> &termStructure,
+	const boost::shared_ptr<IborIndex> &index,
+	const boost::shared_ptr<HullWhite> &model) {
+	return PortfolioPricer(positions, termStructure, index, model).value();
+}
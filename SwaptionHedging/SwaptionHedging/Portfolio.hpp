@@ -0,0 +1,114 @@
+#ifndef     _PORTFOLIO_HPP_
+# define    _PORTFOLIO_HPP_
+
+#include <ql/quantlib.hpp>
+#include "ScheduleCache.hpp"
+#include "BitmapCalendar.hpp"
+#include <string>
+#include <vector>
+
+// This file and Portfolio.cpp read a portfolio of swaptions and hedge swaps and value it on one date //
+
+// Portfolio file layout (one position per row, Notional is negative for short positions):
+// Id,Instrument,Type,Notional,Settlement,Maturity,Tenor,Strike
+// SWPT_7x6,Swaption,Payer,1000,20080701,7,6,0.050826
+// HEDGE_7x6,Swap,Payer,-589,20080701,7,6,0.050826
+
+struct Position {
+	std::string id;
+	bool isSwaption; // otherwise it is a hedge swap
+	QuantLib::VanillaSwap::Type type;
+	QuantLib::Real notional;
+	QuantLib::Date settlement;
+	QuantLib::Integer maturity; // years from settlement to swap start, i.e. swaption expiry
+	QuantLib::Integer tenor; // years of the underlying swap
+	QuantLib::Rate strike;
+};
+
+// swaptions with the same schedule, type and strike are priced once and scaled by notional
+struct StrikeBucket {
+	QuantLib::VanillaSwap::Type type;
+	QuantLib::Rate strike;
+	std::vector<QuantLib::Size> positions;
+};
+
+// positions sharing one swap schedule, the schedules and underlying swap are built once per date
+struct ScheduleGroup {
+	QuantLib::Date settlement;
+	QuantLib::Integer maturity;
+	QuantLib::Integer tenor;
+	std::vector<QuantLib::Size> swaps;
+	std::vector<StrikeBucket> swaptions;
+};
+
+struct PositionValue {
+	QuantLib::Real value;
+	QuantLib::Real delta; // change of value for 1bp move of the forward swap rate
+	QuantLib::Real vega; // change of value for 1% move of the Black volatility
+};
+
+struct PortfolioValue {
+	QuantLib::Real swaptionValue;
+	QuantLib::Real swapValue;
+	QuantLib::Real value;
+	QuantLib::Real delta;
+	QuantLib::Real vega;
+	std::vector<PositionValue> positions; // same order as the portfolio file
+};
+
+// TARGET with its business days precomputed from 1990 to 2100, the calendar of every leg
+const BitmapCalendar &targetCalendar();
+
+// schedules of the underlying swap, same conventions as the original 7x6 trade
+QuantLib::Date swapStartDate(const QuantLib::Date &settlement, QuantLib::Integer maturity);
+QuantLib::Schedule fixedLegSchedule(const QuantLib::Date &settlement, QuantLib::Integer maturity, QuantLib::Integer tenor);
+QuantLib::Schedule floatingLegSchedule(const QuantLib::Date &settlement, QuantLib::Integer maturity, QuantLib::Integer tenor);
+QuantLib::DayCounter fixedLegDayCounter();
+
+// the same legs from ScheduleCache, with the accruals in the leg's day counter and the payment times in the
+// given one (the curve's); the schedules above are these with Actual/360, the day counter of the curve and index
+boost::shared_ptr<const CachedSchedule> fixedLeg(const QuantLib::Date &settlement, QuantLib::Integer maturity,
+	QuantLib::Integer tenor, const QuantLib::DayCounter &timeDayCounter);
+boost::shared_ptr<const CachedSchedule> floatingLeg(const QuantLib::Date &settlement, QuantLib::Integer maturity,
+	QuantLib::Integer tenor, const QuantLib::DayCounter &accrualDayCounter, const QuantLib::DayCounter &timeDayCounter);
+
+std::vector<Position> readPortfolio(const std::string &filename);
+
+std::vector<ScheduleGroup> groupPositions(const std::vector<Position> &positions);
+
+// value, delta and vega of a unit notional swaption, with the forward and annuity of its underlying
+PositionValue swaptionGreeks(const QuantLib::Swaption &swaption, QuantLib::VanillaSwap::Type type, QuantLib::Rate strike,
+	QuantLib::Rate forward, QuantLib::Real annuity, const QuantLib::Date &exerciseDate,
+	const QuantLib::Handle<QuantLib::YieldTermStructure> &termStructure);
+
+// instruments of a portfolio built once on a curve handle and a model, value() reprices them
+// after the curve, the evaluation date or the model parameters moved
+class PortfolioPricer {
+public:
+	PortfolioPricer(const std::vector<Position> &positions,
+		const QuantLib::Handle<QuantLib::YieldTermStructure> &termStructure,
+		const boost::shared_ptr<QuantLib::IborIndex> &index,
+		const boost::shared_ptr<QuantLib::HullWhite> &model);
+	PortfolioValue value() const;
+	const std::vector<Position> &positions() const { return positions_; }
+	const std::vector<ScheduleGroup> &groups() const { return groups_; }
+
+private:
+	struct GroupInstruments {
+		QuantLib::Date startDate;
+		boost::shared_ptr<QuantLib::VanillaSwap> unitSwap; // pays no fixed rate
+		std::vector<boost::shared_ptr<QuantLib::Swaption> > swaptions; // one per strike bucket
+	};
+	std::vector<Position> positions_;
+	std::vector<ScheduleGroup> groups_;
+	std::vector<GroupInstruments> instruments_;
+	QuantLib::Handle<QuantLib::YieldTermStructure> termStructure_;
+};
+
+// value every position off one curve and one calibrated Hull-White model
+PortfolioValue valuePortfolio(const std::vector<Position> &positions,
+	const QuantLib::Handle<QuantLib::YieldTermStructure> &termStructure,
+	const boost::shared_ptr<QuantLib::IborIndex> &index,
+	const boost::shared_ptr<QuantLib::HullWhite> &model);
+
+#endif /*!_PORTFOLIO_HPP_*/
@@ -0,0 +1,278 @@
+#ifdef _WIN32
+#  define NOMINMAX
+#  include <winsock2.h>
+#  include <ws2tcpip.h>
+#  pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET socket_t;
+#  define closeSocket closesocket
+#else
+#  include <sys/socket.h>
+#  include <netinet/in.h>
+#  include <netinet/tcp.h>
+#  include <arpa/inet.h>
+#  include <unistd.h>
+typedef int socket_t;
+#  define INVALID_SOCKET (-1)
+#  define closeSocket close
+#endif
+#include "PricingDaemon.hpp"
+#include "Portfolio.hpp"
+#include "LatencyHistogram.hpp"
+#include "CountingEngine.hpp"
+#include "CachedJamshidianSwaptionEngine.hpp"
+#include <cstring>
+#include <iostream>
+
+using namespace QuantLib;
+using namespace std;
+
+static bool readFully(socket_t s, char *buffer, size_t size) {
+	while (size > 0) {
+		int n = recv(s, buffer, static_cast<int>(size), 0);
+		if (n <= 0)
+			return false;
+		buffer += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeFully(socket_t s, const char *buffer, size_t size) {
+	while (size > 0) {
+		int n = send(s, buffer, static_cast<int>(size), 0);
+		if (n <= 0)
+			return false;
+		buffer += n;
+		size -= n;
+	}
+	return true;
+}
+
+static void startSockets() {
+#ifdef _WIN32
+	WSADATA data;
+	QL_REQUIRE(WSAStartup(MAKEWORD(2, 2), &data) == 0, "WSAStartup failed");
+#endif
+}
+
+static sockaddr_in loopback(unsigned short port) {
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // local connections only
+	return address;
+}
+
+static size_t recordSize(uint32_t type) {
+	switch (type) {
+	case PriceSwaptions: return sizeof(PriceRequest);
+	case UpdateDiscount:
+	case UpdateVolatility:
+	case SetDate: return sizeof(QuoteUpdate);
+	default: return 0;
+	}
+}
+
+PricingDaemon::PricingDaemon(Market &market)
+	: market_(market),
+	swapEngine_(countingEngine(boost::shared_ptr<PricingEngine>(
+		new DiscountingSwapEngine(market.termStructure())), "swap engine calculations")),
+	swaptionEngine_(countingEngine(boost::shared_ptr<PricingEngine>(
+		new CachedJamshidianSwaptionEngine(market.model())), "swaption engine calculations")) {}
+
+const PricingDaemon::UnitSwap &PricingDaemon::unitSwap(Integer expiry, Integer tenor) {
+	pair<Integer, Integer> key(expiry, tenor);
+	map<pair<Integer, Integer>, UnitSwap>::iterator it = swaps_.find(key);
+	if (it != swaps_.end())
+		return it->second;
+
+	// unit payer swap paying no fixed rate starting expiry years from today
+	UnitSwap s;
+	s.startDate = swapStartDate(market_.today(), expiry);
+	s.swap = boost::shared_ptr<VanillaSwap>(new VanillaSwap(
+		VanillaSwap::Payer, 1.0,
+		fixedLegSchedule(market_.today(), expiry, tenor), 0.0, fixedLegDayCounter(),
+		floatingLegSchedule(market_.today(), expiry, tenor), market_.index(), 0.0,
+		market_.index()->dayCounter()));
+	s.swap->setPricingEngine(swapEngine_);
+	return swaps_[key] = s;
+}
+
+const boost::shared_ptr<Swaption> &PricingDaemon::swaption(Integer expiry, Integer tenor,
+	VanillaSwap::Type type, Rate strike) {
+	pair<pair<Integer, Integer>, pair<int, Rate> > key(make_pair(expiry, tenor), make_pair(int(type), strike));
+	boost::shared_ptr<Swaption> &result = swaptions_[key];
+	if (!result) {
+		boost::shared_ptr<VanillaSwap> swap(new VanillaSwap(
+			type, 1.0,
+			fixedLegSchedule(market_.today(), expiry, tenor), strike, fixedLegDayCounter(),
+			floatingLegSchedule(market_.today(), expiry, tenor), market_.index(), 0.0,
+			market_.index()->dayCounter()));
+		swap->setPricingEngine(swapEngine_);
+		boost::shared_ptr<Exercise> europeanExercise(new EuropeanExercise(unitSwap(expiry, tenor).startDate));
+		result = boost::shared_ptr<Swaption>(new Swaption(swap, europeanExercise));
+		result->setPricingEngine(swaptionEngine_);
+	}
+	return result;
+}
+
+// the instruments take their observer registrations on the shared curve and model with them. What can be left
+// in the arena, like the arguments the engines keep from their last calculation, keeps its blocks alive until
+// it goes too; the engine and schedule caches come from the heap
+void PricingDaemon::clearInstruments() {
+	swaptions_.clear();
+	swaps_.clear();
+	COUNT("arena allocations", arena_.allocations());
+	COUNT("arena allocations alive at release", arena_.release());
+}
+
+ResponseHeader PricingDaemon::handle(const RequestHeader &header, const vector<char> &payload, vector<char> &reply) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	ResponseHeader response = { PricingMagic, StatusOk, 0, 0, 0.0 };
+	reply.clear();
+	// handle is public, the payload may not come from serve: never read past the records it holds
+	size_t size = recordSize(header.type);
+	if (size > 0 && payload.size() / size < header.count) {
+		response.status = StatusBadRequest;
+		response.micros = microsSince(start);
+		return response;
+	}
+	try {
+		switch (header.type) {
+		case PriceSwaptions: {
+			const PriceRequest *requests = reinterpret_cast<const PriceRequest *>(payload.data());
+			reply.resize(header.count * sizeof(PriceResponse));
+			PriceResponse *out = reinterpret_cast<PriceResponse *>(reply.data());
+			{
+				// the instruments, their legs and schedules and the engine work all come from the date's arena
+				ArenaScope scope(arena_);
+				for (uint32_t k = 0; k < header.count; k++) {
+					const PriceRequest &r = requests[k];
+					QL_REQUIRE(r.expiry >= 1 && r.tenor >= 1, "bad swaption " << r.expiry << "x" << r.tenor);
+					const UnitSwap &s = unitSwap(r.expiry, r.tenor);
+					Real annuity = -s.swap->fixedLegBPS() / 1.0e-4;
+					Rate forward = s.swap->floatingLegNPV() / annuity;
+					Rate strike = (r.strike > 0.0) ? r.strike : forward;
+					VanillaSwap::Type type = r.payer ? VanillaSwap::Payer : VanillaSwap::Receiver;
+					PositionValue unit = swaptionGreeks(*swaption(r.expiry, r.tenor, type, strike),
+						type, strike, forward, annuity, s.startDate, market_.termStructure());
+					out[k].value = r.notional * unit.value;
+					out[k].delta = r.notional * unit.delta;
+					out[k].vega = r.notional * unit.vega;
+					out[k].forward = forward;
+					out[k].strike = strike;
+				}
+			}
+			response.count = header.count;
+			// at-the-money strikes follow the curve, do not let the cache grow without bound
+			if (swaptions_.size() > 100000)
+				clearInstruments();
+			break;
+		}
+		case UpdateDiscount:
+		case UpdateVolatility:
+		case SetDate: {
+			const QuoteUpdate *updates = reinterpret_cast<const QuoteUpdate *>(payload.data());
+			MarketTransaction update(market_); // one notification per observer for the whole request
+			for (uint32_t k = 0; k < header.count; k++) {
+				const QuoteUpdate &u = updates[k];
+				if (header.type == UpdateDiscount)
+					market_.setDiscountFactor(u.i, u.value);
+				else if (header.type == UpdateVolatility)
+					market_.setVolatility(u.i, u.j, u.value);
+				else {
+					market_.setEvaluationDate(Date(u.i % 100, Month(u.i / 100 % 100), u.i / 10000));
+					clearInstruments(); // instruments are relative to today
+				}
+			}
+			response.recalibrated = update.commit() ? 1 : 0;
+			break;
+		}
+		case Shutdown:
+			break;
+		default:
+			response.status = StatusBadRequest;
+		}
+	} catch (std::exception &e) {
+		cerr << "request failed: " << e.what() << endl;
+		response.status = StatusError;
+		response.count = 0;
+		reply.clear();
+	}
+	response.micros = microsSince(start);
+	return response;
+}
+
+void PricingDaemon::serve(unsigned short port) {
+	startSockets();
+	socket_t listener = socket(AF_INET, SOCK_STREAM, 0);
+	QL_REQUIRE(listener != INVALID_SOCKET, "cannot create socket");
+	int on = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&on), sizeof(on));
+	sockaddr_in address = loopback(port);
+	QL_REQUIRE(::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0,
+		"cannot bind to port " << port);
+	QL_REQUIRE(listen(listener, 8) == 0, "cannot listen on port " << port);
+	cout << "pricing daemon listening on 127.0.0.1:" << port << endl;
+
+	LatencyHistogram latency;
+	bool running = true;
+	while (running) {
+		socket_t client = accept(listener, 0, 0);
+		if (client == INVALID_SOCKET)
+			continue;
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&on), sizeof(on));
+
+		// any number of requests per connection
+		RequestHeader header;
+		vector<char> payload, reply;
+		while (running && readFully(client, reinterpret_cast<char *>(&header), sizeof(header))) {
+			ResponseHeader response = { PricingMagic, StatusBadRequest, 0, 0, 0.0 };
+			size_t size = recordSize(header.type) * header.count;
+			bool valid = header.magic == PricingMagic && size <= (64u << 20);
+			if (valid) {
+				payload.resize(size);
+				if (size > 0 && !readFully(client, payload.data(), size))
+					break;
+				response = handle(header, payload, reply);
+				latency.add(response.micros);
+				running = (header.type != Shutdown);
+			} else
+				reply.clear();
+			if (!writeFully(client, reinterpret_cast<const char *>(&response), sizeof(response))
+				|| !writeFully(client, reply.data(), reply.size()) || !valid)
+				break;
+		}
+		closeSocket(client);
+	}
+	closeSocket(listener);
+	cout << latency.count() << " requests, latency us: mean " << latency.mean() << ", median < "
+		<< latency.quantile(0.5) << ", 99% < " << latency.quantile(0.99) << ", max " << latency.max() << endl;
+}
+
+ResponseHeader sendPricingRequest(unsigned short port, RequestType type, const void *records,
+	uint32_t count, size_t recordSize, vector<char> &reply) {
+	startSockets();
+	socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+	QL_REQUIRE(s != INVALID_SOCKET, "cannot create socket");
+	sockaddr_in address = loopback(port);
+	QL_REQUIRE(connect(s, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0,
+		"no pricing daemon on port " << port);
+	int on = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&on), sizeof(on));
+
+	RequestHeader header = { PricingMagic, uint32_t(type), count, 0 };
+	ResponseHeader response;
+	bool ok = writeFully(s, reinterpret_cast<const char *>(&header), sizeof(header))
+		&& writeFully(s, static_cast<const char *>(records), count * recordSize)
+		&& readFully(s, reinterpret_cast<char *>(&response), sizeof(response));
+	if (ok) {
+		size_t size = (type == PriceSwaptions) ? response.count * sizeof(PriceResponse) : 0;
+		reply.resize(size);
+		ok = size == 0 || readFully(s, reply.data(), size);
+	}
+	closeSocket(s);
+	QL_REQUIRE(ok, "pricing daemon closed the connection");
+	return response;
+}
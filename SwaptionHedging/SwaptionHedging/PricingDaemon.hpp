@@ -0,0 +1,48 @@
+#ifndef     _PRICINGDAEMON_HPP_
+# define    _PRICINGDAEMON_HPP_
+
+#include "Market.hpp"
+#include "PricingProtocol.hpp"
+#include "Arena.hpp"
+#include <map>
+#include <vector>
+
+// This file and PricingDaemon.cpp answer pricing requests over a local socket from a Market that stays
+// calibrated in memory, instruments are built on first use and kept for later requests. Everything a pricing
+// request allocates, the instruments of the date with their legs, schedules and engine results included, comes
+// from an arena that is released in one go when the date changes. //
+
+class PricingDaemon {
+public:
+	explicit PricingDaemon(Market &market);
+
+	// listen on 127.0.0.1:port and serve connections one after another until a Shutdown request
+	void serve(unsigned short port);
+
+	// handle one request, exposed so that it can be driven without a socket
+	ResponseHeader handle(const RequestHeader &header, const std::vector<char> &payload, std::vector<char> &reply);
+
+private:
+	struct UnitSwap {
+		QuantLib::Date startDate;
+		boost::shared_ptr<QuantLib::VanillaSwap> swap;
+	};
+	const UnitSwap &unitSwap(QuantLib::Integer expiry, QuantLib::Integer tenor);
+	const boost::shared_ptr<QuantLib::Swaption> &swaption(QuantLib::Integer expiry, QuantLib::Integer tenor,
+		QuantLib::VanillaSwap::Type type, QuantLib::Rate strike);
+	void clearInstruments();
+
+	Market &market_;
+	boost::shared_ptr<QuantLib::PricingEngine> swapEngine_;
+	boost::shared_ptr<QuantLib::PricingEngine> swaptionEngine_;
+	Arena arena_; // declared before the caches, so it outlives the instruments in it
+	std::map<std::pair<QuantLib::Integer, QuantLib::Integer>, UnitSwap> swaps_;
+	std::map<std::pair<std::pair<QuantLib::Integer, QuantLib::Integer>, std::pair<int, QuantLib::Rate> >,
+		boost::shared_ptr<QuantLib::Swaption> > swaptions_;
+};
+
+// client side: send one request and read the reply, returns the response header
+ResponseHeader sendPricingRequest(unsigned short port, RequestType type, const void *records,
+	std::uint32_t count, std::size_t recordSize, std::vector<char> &reply);
+
+#endif /*!_PRICINGDAEMON_HPP_*/
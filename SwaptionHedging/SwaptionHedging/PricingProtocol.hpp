@@ -0,0 +1,74 @@
+#ifndef     _PRICINGPROTOCOL_HPP_
+# define    _PRICINGPROTOCOL_HPP_
+
+#include <cstdint>
+
+// Binary protocol of the pricing daemon (SwaptionHedging --daemon). Every request is a RequestHeader
+// followed by count records of the type given below, every response is a ResponseHeader followed by
+// count records. All fields are little-endian and the structs have no padding.
+//
+//   PriceSwaptions   PriceRequest  -> PriceResponse, one per request record
+//   UpdateDiscount   QuoteUpdate (i = pillar 1..24, value = discount factor) -> nothing
+//   UpdateVolatility QuoteUpdate (i = expiry, j = tenor in years 1..10, value = vol, 0.2 for 20%) -> nothing
+//   SetDate          QuoteUpdate (i = yyyymmdd) -> nothing, cached instruments are dropped
+//   Shutdown         no records -> nothing
+//
+// Updates are applied in place and the model is recalibrated only when it no longer fits the basket.
+
+const std::uint32_t PricingMagic = 0x44505753; // "SWPD"
+
+enum RequestType {
+	PriceSwaptions = 1,
+	UpdateDiscount = 2,
+	UpdateVolatility = 3,
+	SetDate = 4,
+	Shutdown = 5
+};
+
+enum ResponseStatus {
+	StatusOk = 0,
+	StatusBadRequest = 1,
+	StatusError = 2
+};
+
+#pragma pack(push, 1)
+struct RequestHeader {
+	std::uint32_t magic;
+	std::uint32_t type;
+	std::uint32_t count;
+	std::uint32_t reserved;
+};
+
+struct PriceRequest {
+	std::int32_t expiry; // years from today to the swap start
+	std::int32_t tenor; // years of the underlying swap
+	std::int32_t payer; // 1 payer, 0 receiver
+	std::int32_t reserved;
+	double strike; // 0 or negative for at-the-money
+	double notional;
+};
+
+struct QuoteUpdate {
+	std::int32_t i;
+	std::int32_t j;
+	double value;
+};
+
+struct ResponseHeader {
+	std::uint32_t magic;
+	std::uint32_t status;
+	std::uint32_t count;
+	std::uint32_t recalibrated; // 1 if the request triggered a recalibration
+	double micros; // time spent on the request inside the daemon
+};
+
+struct PriceResponse {
+	double value;
+	double delta; // per 1bp move of the forward swap rate
+	double vega; // per 1% move of the Black volatility
+	double forward;
+	double strike;
+};
+#pragma pack(pop)
+
+#endif /*!_PRICINGPROTOCOL_HPP_*/
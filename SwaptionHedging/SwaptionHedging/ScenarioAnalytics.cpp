@@ -0,0 +1,155 @@
+#include "ScenarioAnalytics.hpp"
+#include "CSVparser.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+double PillarCurve::discount(double t) const {
+	size_t n = times.size();
+	if (t >= times[n - 1]) {
+		double slope = (dfs[n - 1] - dfs[n - 2]) / (times[n - 1] - times[n - 2]);
+		return dfs[n - 1] * std::exp(slope / dfs[n - 1] * (t - times[n - 1]));
+	}
+	size_t i = 1;
+	while (times[i] < t)
+		i++;
+	double w = (t - times[i - 1]) / (times[i] - times[i - 1]);
+	return dfs[i - 1] + w * (dfs[i] - dfs[i - 1]);
+}
+
+double PillarCurve::forward(double t) const {
+	size_t n = times.size();
+	if (t >= times[n - 1]) // flat after the last pillar
+		return -(dfs[n - 1] - dfs[n - 2]) / (times[n - 1] - times[n - 2]) / dfs[n - 1];
+	size_t i = 1;
+	while (times[i] <= t)
+		i++;
+	double slope = (dfs[i] - dfs[i - 1]) / (times[i] - times[i - 1]);
+	return -slope / discount(t);
+}
+
+BondCoefficients hwBondCoefficients(const PillarCurve &curve, double a, double sigma, double t,
+	const vector<double> &maturities) {
+	BondCoefficients c;
+	c.t = t;
+	double Pt = curve.discount(t);
+	double f = curve.forward(t);
+	double variance = sigma * sigma / (4.0 * a) * (1.0 - std::exp(-2.0 * a * t));
+	for (size_t i = 0; i < maturities.size(); i++) {
+		double B = (1.0 - std::exp(-a * (maturities[i] - t))) / a;
+		c.A.push_back(curve.discount(maturities[i]) / Pt * std::exp(B * f - variance * B * B));
+		c.B.push_back(B);
+	}
+	return c;
+}
+
+double scenarioValue(const ScenarioInstrument &instrument, const PillarCurve &curve, double a, double sigma) {
+	HullWhiteSwaption swaption = instrument.swaption;
+	swaption.a = a;
+	swaption.sigma = sigma;
+	vector<double> maturities(1, swaption.expiry);
+	maturities.insert(maturities.end(), swaption.payTimes.begin(), swaption.payTimes.end());
+	// the short rate today is the instantaneous forward, the bond prices are then the discount factors
+	BondCoefficients today = hwBondCoefficients(curve, a, sigma, 0.0, maturities);
+	double r0 = curve.forward(0.0);
+	if (!instrument.isSwaption)
+		return instrument.notional * hwSwapValue(swaption, today, r0);
+	hwJamshidianStrikes(swaption, hwBondCoefficients(curve, a, sigma, swaption.expiry, maturities));
+	return instrument.notional * hwSwaptionValue(swaption, today, r0);
+}
+
+double forwardSwapRate(const PillarCurve &curve, double start, const vector<double> &payTimes,
+	const vector<double> &accruals) {
+	double annuity = 0.0;
+	for (size_t i = 0; i < payTimes.size(); i++)
+		annuity += accruals[i] * curve.discount(payTimes[i]);
+	return (curve.discount(start) - curve.discount(payTimes.back())) / annuity;
+}
+
+vector<Scenario> readScenarios(const string &filename) {
+	Parser data = Parser(filename); // from CSVParser
+	vector<Scenario> result;
+	for (unsigned int i = 0; i < data.rowCount(); i++) {
+		string id = data[i]["Id"];
+		string type = data[i]["Shock"];
+		Shock shock;
+		if (type == "Parallel")
+			shock.type = ParallelShock;
+		else if (type == "Twist")
+			shock.type = TwistShock;
+		else if (type == "Pillar")
+			shock.type = PillarShock;
+		else if (type == "VolScale")
+			shock.type = VolScaleShock;
+		else if (type == "VolShift")
+			shock.type = VolShiftShock;
+		else
+			throw runtime_error("unknown shock " + type + " in scenario " + id);
+		shock.size = stod(data[i]["Size"]);
+		shock.pillar = stod(data[i]["Pillar"]);
+
+		// shocks of one scenario are usually next to each other
+		size_t s = result.size();
+		while (s > 0 && result[s - 1].id != id)
+			s--;
+		if (s == 0) {
+			Scenario scenario;
+			scenario.id = id;
+			result.push_back(scenario);
+			s = result.size();
+		}
+		result[s - 1].shocks.push_back(shock);
+	}
+	return result;
+}
+
+vector<double> shockedDiscounts(const PillarCurve &curve, const Scenario &scenario) {
+	vector<double> dfs = curve.dfs;
+	for (size_t k = 0; k < scenario.shocks.size(); k++) {
+		const Shock &shock = scenario.shocks[k];
+		for (size_t i = 1; i < dfs.size(); i++) {
+			double t = curve.times[i];
+			double shift = 0.0; // of the continuously compounded zero rate
+			if (shock.type == ParallelShock)
+				shift = shock.size;
+			else if (shock.type == TwistShock)
+				shift = shock.size * (t - shock.pillar) / 10.0;
+			else if (shock.type == PillarShock && size_t(shock.pillar) == i)
+				shift = shock.size;
+			dfs[i] *= std::exp(-shift * 1.0e-4 * t);
+		}
+	}
+	return dfs;
+}
+
+vector<double> shockedVols(const vector<double> &vols, const Scenario &scenario) {
+	vector<double> result = vols;
+	for (size_t k = 0; k < scenario.shocks.size(); k++) {
+		const Shock &shock = scenario.shocks[k];
+		for (size_t i = 0; i < result.size(); i++) {
+			if (shock.type == VolScaleShock)
+				result[i] *= 1.0 + shock.size;
+			else if (shock.type == VolShiftShock)
+				result[i] += shock.size;
+		}
+	}
+	return result;
+}
+
+TailRisk historicalTailRisk(vector<double> pnl, double confidence) {
+	TailRisk result = { 0.0, 0.0, 0 };
+	if (pnl.empty())
+		return result;
+	sort(pnl.begin(), pnl.end()); // worst first
+	size_t tail = size_t(std::ceil((1.0 - confidence) * pnl.size() - 1.0e-9));
+	tail = std::max<size_t>(1, std::min(tail, pnl.size()));
+	double sum = 0.0;
+	for (size_t k = 0; k < tail; k++)
+		sum += pnl[k];
+	result.valueAtRisk = -pnl[tail - 1];
+	result.expectedShortfall = -sum / tail;
+	result.tailScenarios = tail;
+	return result;
+}
@@ -0,0 +1,78 @@
+#ifndef     _SCENARIOANALYTICS_HPP_
+# define    _SCENARIOANALYTICS_HPP_
+
+#include "HullWhiteAnalytics.hpp"
+#include <string>
+#include <vector>
+
+// This file and ScenarioAnalytics.cpp shock the curve and the vol surface and reprice swaptions and swaps
+// in the Hull-White model on the shocked curve, with no QuantLib objects, so scenarios can be repriced
+// in parallel off one shared description of the instruments. //
+
+// discount factors at the curve pillar times, linear in between like QuotedDiscountCurve and flat
+// forward after the last pillar
+struct PillarCurve {
+	std::vector<double> times; // times[0] = 0 with discount factor 1.0
+	std::vector<double> dfs;
+	double discount(double t) const;
+	double forward(double t) const; // instantaneous forward rate
+};
+
+// bond coefficients seen from time t of the Hull-White model fitted to the curve, the same as
+// HullWhite::discountBond; maturities[0] is the swap start
+BondCoefficients hwBondCoefficients(const PillarCurve &curve, double a, double sigma, double t,
+	const std::vector<double> &maturities);
+
+// a swaption or a swap on a unit notional, described like HullWhiteSwaption (a, sigma and the Jamshidian
+// strikes are set for every scenario), the swap is valued as its start bond minus the coupon bond
+struct ScenarioInstrument {
+	std::string id;
+	double notional;
+	bool isSwaption;
+	HullWhiteSwaption swaption;
+};
+
+// value today on the curve with the model parameters
+double scenarioValue(const ScenarioInstrument &instrument, const PillarCurve &curve, double a, double sigma);
+
+// forward rate of a swap starting at start with fixed payments at payTimes, i.e. the ATM strike
+double forwardSwapRate(const PillarCurve &curve, double start, const std::vector<double> &payTimes,
+	const std::vector<double> &accruals);
+
+// Scenario file layout (one shock per row, rows with the same Id add up to one scenario):
+// Id,Shock,Size,Pillar
+// UP100,Parallel,100,0          zero rates of all pillars up by Size bp
+// STEEP25,Twist,25,5            zero rates up by Size bp per 10 years after the Pillar year, down before it
+// P10Y,Pillar,1,16              zero rate of pillar 1..24 (see curvePillars) up by Size bp
+// VOLUP,VolScale,0.2,0          every vol times 1 + Size
+// VOLSHIFT,VolShift,0.01,0      every vol plus Size
+enum ShockType { ParallelShock, TwistShock, PillarShock, VolScaleShock, VolShiftShock };
+
+struct Shock {
+	ShockType type;
+	double size;
+	double pillar; // pillar index for PillarShock, pivot year for TwistShock
+};
+
+struct Scenario {
+	std::string id;
+	std::vector<Shock> shocks;
+};
+
+std::vector<Scenario> readScenarios(const std::string &filename);
+
+// discount factors of the pillars and vols of the surface with the shocks of the scenario applied
+std::vector<double> shockedDiscounts(const PillarCurve &curve, const Scenario &scenario);
+std::vector<double> shockedVols(const std::vector<double> &vols, const Scenario &scenario);
+
+// value at risk and expected shortfall of a P&L sample, both as positive losses: VaR is the loss exceeded
+// by a share 1 - confidence of the scenarios, ES the mean loss of those tail scenarios including VaR
+struct TailRisk {
+	double valueAtRisk;
+	double expectedShortfall;
+	std::size_t tailScenarios;
+};
+
+TailRisk historicalTailRisk(std::vector<double> pnl, double confidence);
+
+#endif /*!_SCENARIOANALYTICS_HPP_*/
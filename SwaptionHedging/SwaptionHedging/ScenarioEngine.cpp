@@ -0,0 +1,170 @@
+#include "ScenarioEngine.hpp"
+#include "MarketData.hpp"
+#include "StageTimer.hpp"
+#include "TaskScheduler.hpp"
+#include <algorithm>
+
+using namespace QuantLib;
+using namespace std;
+
+// instruments repriced by one task, a tenth of the grid
+static const Size scenarioTaskSize = 10;
+
+// swaption or swap of a schedule on a unit notional, in the curve's time measure
+static ScenarioInstrument scenarioInstrument(const string &id, Real notional, bool isSwaption,
+	VanillaSwap::Type type, const Date &settlement, Integer maturity, Integer tenor, Rate strike,
+	const Handle<YieldTermStructure> &termStructure, vector<Real> &accruals) {
+	ScenarioInstrument instrument;
+	instrument.id = id;
+	instrument.notional = notional;
+	instrument.isSwaption = isSwaption;
+	HullWhiteSwaption &swaption = instrument.swaption;
+	swaption.a = swaption.sigma = 0.0; // set for every scenario
+	swaption.payer = (type == VanillaSwap::Payer);
+	boost::shared_ptr<const CachedSchedule> leg = fixedLeg(settlement, maturity, tenor, termStructure->dayCounter());
+	swaption.expiry = termStructure->timeFromReference(leg->dates[0]);
+	accruals = leg->accruals;
+	for (Size i = 0; i < accruals.size(); i++) {
+		swaption.payTimes.push_back(swaption.expiry + leg->timesFromStart[i]);
+		swaption.coupons.push_back(strike * accruals[i]);
+	}
+	swaption.coupons.back() += 1.0;
+	return instrument;
+}
+
+ScenarioEngine::ScenarioEngine(Market &market, const vector<double> &dfs, const vector<double> &vols,
+	const vector<Position> &positions, bool withGrid)
+	: market_(market), baseVols_(vols), gridSize_(0) {
+	Handle<YieldTermStructure> termStructure = market.termStructure();
+	Date today = market.today();
+	vector<Period> pillars = curvePillars();
+	for (Size i = 0; i < pillars.size(); i++)
+		baseCurve_.times.push_back(termStructure->timeFromReference(today + pillars[i]));
+	baseCurve_.dfs = dfs;
+
+	// ATM payer swaptions of the base curve, 1-10Yr expiries and tenors
+	vector<Real> accruals;
+	if (withGrid) {
+		for (Integer i = 1; i <= 10; i++) {
+			for (Integer j = 1; j <= 10; j++) {
+				ScenarioInstrument instrument = scenarioInstrument(to_string(i) + "x" + to_string(j), 1.0, true,
+					VanillaSwap::Payer, today, i, j, 0.0, termStructure, accruals);
+				HullWhiteSwaption &swaption = instrument.swaption;
+				Rate strike = forwardSwapRate(baseCurve_, swaption.expiry, swaption.payTimes, accruals);
+				for (Size k = 0; k < accruals.size(); k++)
+					swaption.coupons[k] = strike * accruals[k];
+				swaption.coupons.back() += 1.0;
+				instruments_.push_back(instrument);
+			}
+		}
+		gridSize_ = instruments_.size();
+	}
+	for (Size n = 0; n < positions.size(); n++) {
+		const Position &p = positions[n];
+		instruments_.push_back(scenarioInstrument(p.id, p.notional, p.isSwaption, p.type,
+			p.settlement, p.maturity, p.tenor, p.strike, termStructure, accruals));
+	}
+}
+
+ScenarioMarket ScenarioEngine::shock(const Scenario &scenario) const {
+	ScenarioMarket result = { scenario.id, shockedDiscounts(baseCurve_, scenario), shockedVols(baseVols_, scenario) };
+	return result;
+}
+
+vector<ScenarioMarket> ScenarioEngine::historicalScenarios(const Date &first, const Date &last) const {
+	ScopedStage stage("historical scenarios");
+	vector<ScenarioMarket> scenarios;
+	vector<double> lastDfs = DiscountFactorVec("DF_" + dateToString(first) + ".csv");
+	vector<double> lastVols = ImpliedVolatilityVec("IV_" + dateToString(first) + ".csv");
+	for (Date d = first + 1; d <= last; d++) {
+		string dateString = dateToString(d);
+		vector<double> dfs = DiscountFactorVec("DF_" + dateString + ".csv");
+		vector<double> vols = ImpliedVolatilityVec("IV_" + dateString + ".csv");
+		if (dfs == lastDfs && vols == lastVols)
+			continue;
+		ScenarioMarket scenario = { dateString, baseCurve_.dfs, baseVols_ };
+		for (Size i = 1; i < dfs.size(); i++)
+			scenario.dfs[i] *= dfs[i] / lastDfs[i];
+		for (Size k = 0; k < vols.size(); k++)
+			if (vols[k] != lastVols[k]) // unchanged vols stay exactly the base vols, no recalibration
+				scenario.vols[k] = std::max(scenario.vols[k] + vols[k] - lastVols[k], 1.0e-4);
+		scenarios.push_back(scenario);
+		lastDfs = dfs;
+		lastVols = vols;
+	}
+	stage.arg("scenarios", Real(scenarios.size()));
+	return scenarios;
+}
+
+ScenarioResults ScenarioEngine::run(const vector<ScenarioMarket> &scenarios, unsigned int threads, bool recalibrateAll) {
+	ScenarioResults results;
+	Size n = scenarios.size(), m = instruments_.size();
+	Array baseParams = market_.model()->params();
+	Real baseA = baseParams[0], baseSigma = baseParams[1];
+	for (Size i = 0; i < m; i++) {
+		results.instruments.push_back(instruments_[i].id);
+		results.baseValues.push_back(scenarioValue(instruments_[i], baseCurve_, baseA, baseSigma));
+	}
+
+	// one task graph for the run: the calibrations are pinned to one worker and run one after another on the
+	// shared market, QuantLib objects are not thread safe; the repricing of a scenario waits for its own
+	// calibration only, so the other workers price while later scenarios are still calibrating
+	ScopedStage stage("scenarios");
+	results.a.assign(n, baseA);
+	results.sigma.assign(n, baseSigma);
+	results.calibrations = 0;
+	results.pnl.assign(n, vector<double>(m, 0.0));
+	results.portfolioPnL.assign(n, 0.0);
+	TaskScheduler scheduler(threads);
+	Date today = market_.today();
+	// every scenario calibrates from the base model, not from the scenario calibrated before it, so the
+	// results do not depend on the order of the scenarios
+	Array calibrationStart = market_.calibrationStart();
+	market_.setCalibrationStart(baseParams);
+	vector<TaskScheduler::TaskId> calibrations;
+	for (Size k = 0; k < n; k++) {
+		vector<TaskScheduler::TaskId> dependencies;
+		if (recalibrateAll || scenarios[k].vols != baseVols_) {
+			dependencies.push_back(scheduler.submit([&, k]() {
+				ScopedStage calibrationStage("scenario calibration", scenarios[k].id);
+				MarketTransaction update(market_);
+				market_.setMarket(today, scenarios[k].dfs, scenarios[k].vols);
+				update.commit(true);
+				results.a[k] = market_.model()->params()[0];
+				results.sigma[k] = market_.model()->params()[1];
+			}, vector<TaskScheduler::TaskId>(), true));
+			calibrations.push_back(dependencies.back());
+			results.calibrations++;
+		}
+
+		// every scenario reprices the whole book on its own curve, a few instruments per task
+		for (Size first = 0; first < m; first += scenarioTaskSize) {
+			Size last = std::min(first + scenarioTaskSize, m);
+			scheduler.submit([&, k, first, last]() {
+				PillarCurve curve;
+				curve.times = baseCurve_.times;
+				curve.dfs = scenarios[k].dfs;
+				for (Size i = first; i < last; i++)
+					results.pnl[k][i] = scenarioValue(instruments_[i], curve, results.a[k], results.sigma[k])
+						- results.baseValues[i];
+			}, dependencies);
+		}
+	}
+	if (!calibrations.empty())
+		scheduler.submit([&]() {
+			{
+				MarketTransaction update(market_);
+				market_.setMarket(today, baseCurve_.dfs, baseVols_);
+			} // not committed, the base quotes get the base model back rather than a calibration
+			market_.setModelParams(baseParams);
+		}, calibrations, true);
+	scheduler.wait();
+	market_.setCalibrationStart(calibrationStart);
+	results.workers = scheduler.stats();
+	stage.arg("calibrations", Real(results.calibrations));
+
+	for (Size k = 0; k < n; k++)
+		for (Size i = gridSize_; i < m; i++)
+			results.portfolioPnL[k] += results.pnl[k][i];
+	return results;
+}
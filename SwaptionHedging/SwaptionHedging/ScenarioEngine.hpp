@@ -0,0 +1,62 @@
+#ifndef     _SCENARIOENGINE_HPP_
+# define    _SCENARIOENGINE_HPP_
+
+#include "Market.hpp"
+#include "Portfolio.hpp"
+#include "ScenarioAnalytics.hpp"
+#include "TaskScheduler.hpp"
+#include <string>
+#include <vector>
+
+// This file and ScenarioEngine.cpp fully revalue the 10x10 ATM grid and a portfolio under many curve and
+// vol scenarios. The shocks are applied to the quotes of the one shared Market, which recalibrates the
+// model when the vols move; the repricing of every scenario runs in parallel off plain descriptions of the
+// instruments (ScenarioAnalytics.hpp) as soon as its calibration is done (TaskScheduler.hpp). //
+
+// the quotes of one scenario, in the layout of DiscountFactorVec and ImpliedVolatilityVec
+struct ScenarioMarket {
+	std::string id;
+	std::vector<double> dfs;
+	std::vector<double> vols;
+};
+
+struct ScenarioResults {
+	std::vector<std::string> instruments; // grid ids like "7x6", then the position ids
+	std::vector<double> baseValues;
+	std::vector<double> a; // model parameters of every scenario
+	std::vector<double> sigma;
+	std::vector<std::vector<double> > pnl; // scenario by row, instrument by column
+	std::vector<double> portfolioPnL; // sum over the positions of every scenario
+	std::size_t calibrations;
+	std::vector<TaskWorkerStats> workers; // of the scheduler that ran the scenarios
+};
+
+class ScenarioEngine {
+public:
+	// dfs and vols are the quotes the market was built or last set with
+	ScenarioEngine(Market &market, const std::vector<double> &dfs, const std::vector<double> &vols,
+		const std::vector<Position> &positions, bool withGrid = true);
+
+	const PillarCurve &baseCurve() const { return baseCurve_; }
+	const std::vector<double> &baseVols() const { return baseVols_; }
+	ScenarioMarket shock(const Scenario &scenario) const;
+
+	// the model is recalibrated, starting from the base parameters, for scenarios that move a vol, or for all
+	// of them if recalibrateAll, other scenarios keep the parameters of the base market; the market is set back
+	// to its base quotes and parameters after
+	ScenarioResults run(const std::vector<ScenarioMarket> &scenarios, unsigned int threads, bool recalibrateAll = false);
+
+	// one scenario per day of the history whose quotes moved: the day over day change of every zero rate
+	// (the ratio of discount factors) and of every vol, applied to the base market; days that repeat the
+	// quotes of the day before, like weekends, are skipped
+	std::vector<ScenarioMarket> historicalScenarios(const QuantLib::Date &first, const QuantLib::Date &last) const;
+
+private:
+	Market &market_;
+	PillarCurve baseCurve_;
+	std::vector<double> baseVols_;
+	std::vector<ScenarioInstrument> instruments_;
+	std::size_t gridSize_; // the grid comes first, then the positions
+};
+
+#endif /*!_SCENARIOENGINE_HPP_*/
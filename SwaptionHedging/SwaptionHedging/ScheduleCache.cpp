@@ -0,0 +1,68 @@
+#include "ScheduleCache.hpp"
+#include "Counters.hpp"
+#include "Arena.hpp"
+
+using namespace QuantLib;
+using namespace std;
+
+bool ScheduleKey::operator<(const ScheduleKey &other) const {
+	if (start != other.start)
+		return start < other.start;
+	if (end != other.end)
+		return end < other.end;
+	if (frequency != other.frequency)
+		return frequency < other.frequency;
+	if (convention != other.convention)
+		return convention < other.convention;
+	if (calendar != other.calendar)
+		return calendar < other.calendar;
+	if (accrualDayCounter != other.accrualDayCounter)
+		return accrualDayCounter < other.accrualDayCounter;
+	return timeDayCounter < other.timeDayCounter;
+}
+
+ScheduleCache &ScheduleCache::instance() {
+	static ScheduleCache cache;
+	return cache;
+}
+
+boost::shared_ptr<const CachedSchedule> ScheduleCache::schedule(const Date &start, const Date &end,
+	Frequency frequency, const Calendar &calendar, BusinessDayConvention convention,
+	const DayCounter &accrualDayCounter, const DayCounter &timeDayCounter) {
+	ScheduleKey key = { start, end, frequency, calendar.name(), convention,
+		accrualDayCounter.name(), timeDayCounter.name() };
+	{
+		lock_guard<mutex> lock(mutex_);
+		map<ScheduleKey, boost::shared_ptr<const CachedSchedule> >::const_iterator found = schedules_.find(key);
+		if (found != schedules_.end()) {
+			COUNT("schedule cache hits", 1);
+			return found->second;
+		}
+	}
+
+	// built outside the lock, two threads missing the same key at once both build it and the first one is kept.
+	// The cache outlives any arena, so the entry comes from the heap
+	COUNT("schedule cache misses", 1);
+	HeapScope heap;
+	boost::shared_ptr<CachedSchedule> entry(new CachedSchedule());
+	entry->schedule = Schedule(start, end, Period(frequency),
+		calendar, convention, convention,
+		DateGeneration::Forward, false);
+	entry->dates = entry->schedule.dates();
+	for (Size i = 1; i < entry->dates.size(); i++) {
+		entry->accruals.push_back(accrualDayCounter.yearFraction(entry->dates[i - 1], entry->dates[i]));
+		entry->timesFromStart.push_back(timeDayCounter.yearFraction(entry->dates[0], entry->dates[i]));
+	}
+	lock_guard<mutex> lock(mutex_);
+	return schedules_.insert(make_pair(key, boost::shared_ptr<const CachedSchedule>(entry))).first->second;
+}
+
+size_t ScheduleCache::size() const {
+	lock_guard<mutex> lock(mutex_);
+	return schedules_.size();
+}
+
+void ScheduleCache::clear() {
+	lock_guard<mutex> lock(mutex_);
+	schedules_.clear();
+}
@@ -0,0 +1,53 @@
+#ifndef     _SCHEDULECACHE_HPP_
+# define    _SCHEDULECACHE_HPP_
+
+#include <ql/quantlib.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// This file and ScheduleCache.cpp build every swap leg schedule once per process. The same legs come back
+// across dates (positions keep their settlement), across the grid, the daemon and the scenario engine, and each
+// Schedule costs a calendar adjustment per period. An entry keeps the QuantLib Schedule for the instruments
+// and the same leg in flat arrays for the native pricers. Entries are immutable and shared, so the cache can
+// be used from any thread. //
+
+struct ScheduleKey {
+	QuantLib::Date start;
+	QuantLib::Date end;
+	QuantLib::Frequency frequency;
+	std::string calendar; // Calendar::name()
+	QuantLib::BusinessDayConvention convention; // of the dates and of the termination date
+	std::string accrualDayCounter; // DayCounter::name()
+	std::string timeDayCounter;
+	bool operator<(const ScheduleKey &other) const;
+};
+
+struct CachedSchedule {
+	QuantLib::Schedule schedule;
+	std::vector<QuantLib::Date> dates; // dates[0] is the start
+	std::vector<QuantLib::Real> accruals; // of every period in the accrual day counter
+	// of every payment date dates[1..] from the start in the time day counter; with a day counter of actual
+	// days, like the curve's Actual/360, the time from any reference date is its time to the start plus these
+	std::vector<QuantLib::Time> timesFromStart;
+};
+
+class ScheduleCache {
+public:
+	static ScheduleCache &instance();
+
+	// the schedule is generated forward from the start, like the legs of the original 7x6 trade
+	boost::shared_ptr<const CachedSchedule> schedule(const QuantLib::Date &start, const QuantLib::Date &end,
+		QuantLib::Frequency frequency, const QuantLib::Calendar &calendar, QuantLib::BusinessDayConvention convention,
+		const QuantLib::DayCounter &accrualDayCounter, const QuantLib::DayCounter &timeDayCounter);
+	std::size_t size() const;
+	void clear();
+
+private:
+	ScheduleCache() {}
+	mutable std::mutex mutex_;
+	std::map<ScheduleKey, boost::shared_ptr<const CachedSchedule> > schedules_;
+};
+
+#endif /*!_SCHEDULECACHE_HPP_*/
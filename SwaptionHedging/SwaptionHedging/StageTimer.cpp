@@ -0,0 +1,140 @@
+#include "StageTimer.hpp"
+#include "Arena.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <thread>
+
+using namespace std;
+
+// paths of the stages open on this thread, innermost last
+static thread_local vector<string> openStages;
+
+StageTimer &StageTimer::instance() {
+	static StageTimer timer;
+	return timer;
+}
+
+void StageTimer::enable(bool on) {
+	lock_guard<mutex> lock(mutex_);
+	if (on && !enabled_) {
+		origin_ = chrono::steady_clock::now();
+		records_.clear();
+		threads_.clear();
+	}
+	enabled_ = on;
+}
+
+void StageTimer::add(const StageRecord &record) {
+	lock_guard<mutex> lock(mutex_);
+	HeapScope heap; // the records of the run outlive any arena
+	thread::id id = this_thread::get_id();
+	unsigned int k = 0;
+	while (k < threads_.size() && threads_[k] != id)
+		k++;
+	if (k == threads_.size())
+		threads_.push_back(id);
+	records_.push_back(record);
+	records_.back().thread = k;
+}
+
+void StageTimer::writeSummary(ostream &out) const {
+	lock_guard<mutex> lock(mutex_);
+	struct Total { size_t calls; double total; double nested; double first; };
+	map<string, Total> totals;
+	double run = 0.0;
+	for (size_t k = 0; k < records_.size(); k++) {
+		const StageRecord &r = records_[k];
+		Total &t = totals[r.path];
+		if (t.calls == 0 || r.start < t.first)
+			t.first = r.start;
+		t.calls++;
+		t.total += r.duration;
+		string::size_type slash = r.path.rfind('/');
+		if (slash != string::npos)
+			totals[r.path.substr(0, slash)].nested += r.duration;
+		else
+			run += r.duration;
+	}
+
+	// in order of the first call, a stage starts before the stages nested in it
+	vector<pair<double, string> > order;
+	for (map<string, Total>::const_iterator it = totals.begin(); it != totals.end(); ++it)
+		order.push_back(make_pair(it->second.first, it->first));
+	sort(order.begin(), order.end());
+	out << "Stage" << "," << "Calls" << "," << "Total (ms)" << "," << "Self (ms)" << ","
+		<< "Mean (us)" << "," << "Share of run" << endl;
+	for (size_t k = 0; k < order.size(); k++) {
+		const Total &t = totals[order[k].second];
+		out << order[k].second << "," << t.calls << "," << t.total / 1000.0 << "," << (t.total - t.nested) / 1000.0 << ","
+			<< (t.calls > 0 ? t.total / t.calls : 0.0) << "," << (run > 0.0 ? t.total / run : 0.0) << endl;
+	}
+}
+
+static string quoted(const string &s) {
+	string result = "\"";
+	for (size_t i = 0; i < s.size(); i++) {
+		if (s[i] == '"' || s[i] == '\\')
+			result += '\\';
+		result += s[i];
+	}
+	return result + "\"";
+}
+
+void StageTimer::writeTrace(ostream &out) const {
+	lock_guard<mutex> lock(mutex_);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+	out << setprecision(15);
+	for (size_t k = 0; k < records_.size(); k++) {
+		const StageRecord &r = records_[k];
+		out << "{\"name\":" << quoted(r.detail.empty() ? r.name : r.name + " " + r.detail)
+			<< ",\"cat\":" << quoted(r.name) << ",\"ph\":\"X\",\"ts\":" << r.start << ",\"dur\":" << r.duration
+			<< ",\"pid\":1,\"tid\":" << r.thread << ",\"args\":{";
+		for (size_t a = 0; a < r.args.size(); a++)
+			out << (a > 0 ? "," : "") << quoted(r.args[a].first) << ":" << r.args[a].second;
+		out << "}}" << (k + 1 < records_.size() ? "," : "") << endl;
+	}
+	out << "]}" << endl;
+}
+
+void StageTimer::write(const string &summaryFile, const string &traceFile) const {
+	ofstream sFile;
+	sFile.open(summaryFile.c_str(), ios::out | ios::trunc);
+	writeSummary(sFile);
+	sFile.close();
+	ofstream tFile;
+	tFile.open(traceFile.c_str(), ios::out | ios::trunc);
+	writeTrace(tFile);
+	tFile.close();
+}
+
+ScopedStage::ScopedStage(const char *name, const string &detail)
+	: active_(StageTimer::instance().enabled()) {
+	if (!active_)
+		return;
+	record_.name = name;
+	record_.detail = detail;
+	record_.path = openStages.empty() ? record_.name : openStages.back() + "/" + record_.name;
+	{
+		HeapScope heap; // the stack of this thread outlives any arena
+		openStages.push_back(record_.path);
+	}
+	start_ = chrono::steady_clock::now();
+}
+
+ScopedStage::~ScopedStage() {
+	if (!active_)
+		return;
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	StageTimer &timer = StageTimer::instance();
+	record_.start = chrono::duration<double, micro>(start_ - timer.origin_).count();
+	record_.duration = chrono::duration<double, micro>(end - start_).count();
+	openStages.pop_back();
+	timer.add(record_);
+}
+
+void ScopedStage::arg(const char *key, double value) {
+	if (active_)
+		record_.args.push_back(make_pair(string(key), value));
+}
@@ -0,0 +1,65 @@
+#ifndef     _STAGETIMER_HPP_
+# define    _STAGETIMER_HPP_
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// This file and StageTimer.cpp time the stages of a run (loading, curve, calibration, pricing, ...).
+// Stages opened inside another stage on the same thread are nested under it. The records are written
+// as a summary table per stage path and as Chrome trace events (chrome://tracing, Perfetto). //
+
+struct StageRecord {
+	std::string name;
+	std::string detail; // date, instrument, ...
+	std::string path; // names of the enclosing stages and this one, like "date/pricing/implied vol"
+	double start; // us since the timer was enabled
+	double duration; // us
+	unsigned int thread;
+	std::vector<std::pair<std::string, double> > args;
+};
+
+class StageTimer {
+public:
+	static StageTimer &instance();
+
+	// nothing is recorded until enabled, stages then cost two clock reads and one record each
+	void enable(bool on = true);
+	bool enabled() const { return enabled_; }
+
+	// one line per stage path: calls, total, self time (without nested stages), mean
+	void writeSummary(std::ostream &out) const;
+	void writeTrace(std::ostream &out) const; // JSON object format of the trace event format
+	void write(const std::string &summaryFile, const std::string &traceFile) const;
+	const std::vector<StageRecord> &records() const { return records_; }
+
+private:
+	friend class ScopedStage;
+	StageTimer() : enabled_(false) {}
+	void add(const StageRecord &record);
+	bool enabled_;
+	std::chrono::steady_clock::time_point origin_;
+	mutable std::mutex mutex_;
+	std::vector<StageRecord> records_;
+	std::vector<std::thread::id> threads_;
+};
+
+// times the enclosing scope as one stage
+class ScopedStage {
+public:
+	explicit ScopedStage(const char *name, const std::string &detail = std::string());
+	~ScopedStage();
+	void arg(const char *key, double value); // shown with the event in the trace viewer
+
+private:
+	ScopedStage(const ScopedStage &);
+	ScopedStage &operator=(const ScopedStage &);
+	bool active_;
+	StageRecord record_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+#endif /*!_STAGETIMER_HPP_*/
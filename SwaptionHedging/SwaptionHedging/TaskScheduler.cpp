@@ -0,0 +1,223 @@
+#include "TaskScheduler.hpp"
+
+using namespace std;
+
+// the worker the current thread is, to keep the tasks a task makes ready on its own deque
+static thread_local const TaskScheduler *currentScheduler = 0;
+static thread_local unsigned int currentWorker = 0;
+
+TaskScheduler::TaskScheduler(unsigned int workers)
+	: readyCount_(0), pinnedCount_(0), submitted_(0), finished_(0), nextQueue_(0), failed_(false), stop_(false),
+	start_(chrono::steady_clock::now()) {
+	if (workers == 0)
+		workers = 1;
+	for (unsigned int w = 0; w < workers; w++) {
+		queues_.push_back(new WorkerQueue());
+		queues_.back()->executed = queues_.back()->stolen = 0;
+		queues_.back()->busySeconds = 0.0;
+	}
+	for (unsigned int w = 0; w < workers; w++)
+		threads_.push_back(thread([this, w]() { work(w); }));
+}
+
+TaskScheduler::~TaskScheduler() {
+	try {
+		wait();
+	}
+	catch (...) {} // nobody asked for the result
+	{
+		lock_guard<mutex> lock(sleepMutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (size_t t = 0; t < threads_.size(); t++)
+		threads_[t].join();
+	for (size_t w = 0; w < queues_.size(); w++)
+		delete queues_[w];
+}
+
+TaskScheduler::TaskId TaskScheduler::submit(const function<void()> &f, const vector<TaskId> &dependencies, bool pinned) {
+	{
+		lock_guard<mutex> lock(sleepMutex_);
+		submitted_++; // before the task can finish
+	}
+	TaskId id;
+	bool isReady;
+	{
+		lock_guard<mutex> lock(graphMutex_);
+		id = tasks_.size();
+		Task task;
+		task.f = f;
+		task.pending = 0;
+		task.pinned = pinned;
+		task.done = false;
+		tasks_.push_back(task);
+		for (size_t d = 0; d < dependencies.size(); d++) {
+			Task &dependency = tasks_[dependencies[d]];
+			if (!dependency.done) {
+				dependency.dependents.push_back(id);
+				tasks_[id].pending++;
+			}
+		}
+		isReady = (tasks_[id].pending == 0);
+	}
+	if (isReady) {
+		unsigned int worker = (currentScheduler == this) ? currentWorker : nextQueue_++ % workers();
+		ready(id, pinned, worker);
+	}
+	return id;
+}
+
+void TaskScheduler::ready(TaskId id, bool pinned, unsigned int worker) {
+	// counted before it is queued, so the count never drops below the tasks in the queues
+	if (pinned) {
+		pinnedCount_++;
+		lock_guard<mutex> lock(pinnedMutex_);
+		pinned_.push_back(id);
+	}
+	else {
+		readyCount_++;
+		lock_guard<mutex> lock(queues_[worker]->mutex);
+		queues_[worker]->tasks.push_back(id);
+	}
+	// taking the lock orders the count before a worker's check of it, so no wake-up is lost
+	{
+		lock_guard<mutex> lock(sleepMutex_);
+	}
+	if (pinned)
+		wake_.notify_all(); // only worker 0 can take it
+	else
+		wake_.notify_one();
+}
+
+bool TaskScheduler::take(unsigned int worker, TaskId &id, bool &stolen) {
+	stolen = false;
+	if (worker == 0 && pinnedCount_ > 0) { // calibrations first, the pricing waits for them
+		lock_guard<mutex> lock(pinnedMutex_);
+		if (!pinned_.empty()) {
+			id = pinned_.front();
+			pinned_.pop_front();
+			pinnedCount_--;
+			return true;
+		}
+	}
+	if (readyCount_ == 0)
+		return false;
+	{
+		// newest first on the own deque, its data is most likely still in cache
+		WorkerQueue &own = *queues_[worker];
+		lock_guard<mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			id = own.tasks.back();
+			own.tasks.pop_back();
+			readyCount_--;
+			return true;
+		}
+	}
+	for (size_t k = 1; k < queues_.size(); k++) {
+		// oldest first from the others, it is the largest piece of work left behind
+		WorkerQueue &victim = *queues_[(worker + k) % queues_.size()];
+		lock_guard<mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			id = victim.tasks.front();
+			victim.tasks.pop_front();
+			readyCount_--;
+			stolen = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskScheduler::work(unsigned int worker) {
+	currentScheduler = this;
+	currentWorker = worker;
+	while (true) {
+		TaskId id;
+		bool stolen;
+		if (!take(worker, id, stolen)) {
+			unique_lock<mutex> lock(sleepMutex_);
+			wake_.wait(lock, [this, worker]() {
+				return stop_ || readyCount_ > 0 || (worker == 0 && pinnedCount_ > 0);
+			});
+			if (stop_ && readyCount_ == 0 && (worker != 0 || pinnedCount_ == 0))
+				return;
+			continue;
+		}
+
+		function<void()> f;
+		{
+			lock_guard<mutex> lock(graphMutex_);
+			f.swap(tasks_[id].f); // frees what the task captured once it ran
+		}
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (!failed_) {
+			try {
+				f();
+			}
+			catch (...) {
+				lock_guard<mutex> lock(sleepMutex_);
+				if (!error_)
+					error_ = current_exception();
+				failed_ = true;
+			}
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		{
+			WorkerQueue &own = *queues_[worker];
+			lock_guard<mutex> lock(own.mutex);
+			own.executed++;
+			own.stolen += stolen ? 1 : 0;
+			own.busySeconds += seconds;
+		}
+		finish(id, worker);
+	}
+}
+
+void TaskScheduler::finish(TaskId id, unsigned int worker) {
+	vector<pair<TaskId, bool> > released;
+	{
+		lock_guard<mutex> lock(graphMutex_);
+		Task &task = tasks_[id];
+		task.done = true;
+		for (size_t d = 0; d < task.dependents.size(); d++) {
+			Task &dependent = tasks_[task.dependents[d]];
+			if (--dependent.pending == 0)
+				released.push_back(make_pair(task.dependents[d], dependent.pinned));
+		}
+	}
+	for (size_t r = 0; r < released.size(); r++)
+		ready(released[r].first, released[r].second, worker);
+	lock_guard<mutex> lock(sleepMutex_);
+	if (++finished_ == submitted_)
+		idle_.notify_all();
+}
+
+void TaskScheduler::wait() {
+	exception_ptr error;
+	{
+		unique_lock<mutex> lock(sleepMutex_);
+		idle_.wait(lock, [this]() { return finished_ == submitted_; });
+		error = error_;
+		error_ = exception_ptr();
+		failed_ = false;
+	}
+	{
+		lock_guard<mutex> lock(graphMutex_);
+		tasks_.clear(); // the ids handed out so far are done with
+	}
+	if (error)
+		rethrow_exception(error);
+}
+
+vector<TaskWorkerStats> TaskScheduler::stats() const {
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_).count();
+	vector<TaskWorkerStats> result;
+	for (size_t w = 0; w < queues_.size(); w++) {
+		lock_guard<mutex> lock(queues_[w]->mutex);
+		TaskWorkerStats stats = { queues_[w]->executed, queues_[w]->stolen, queues_[w]->busySeconds,
+			elapsed > 0.0 ? queues_[w]->busySeconds / elapsed : 0.0 };
+		result.push_back(stats);
+	}
+	return result;
+}
@@ -0,0 +1,90 @@
+#ifndef     _TASKSCHEDULER_HPP_
+# define    _TASKSCHEDULER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// This file and TaskScheduler.cpp run a graph of small tasks on a fixed set of workers. Every worker keeps
+// its own deque of ready tasks, takes the newest from it and steals the oldest from the others when it runs
+// dry, so a few expensive tasks (a stressed calibration, a long maturity) do not leave the other cores idle
+// the way a static split of the work does. A task starts once the tasks it depends on are done. Pinned tasks
+// all run on worker 0 in the order they were submitted and are never stolen: QuantLib work goes there,
+// since the one Market and QuantLib's settings must not be touched by two threads at once. //
+
+struct TaskWorkerStats {
+	std::size_t tasks;
+	std::size_t stolen; // tasks taken from another worker's deque
+	double busySeconds;
+	double utilization; // busy time over the time since the scheduler started
+};
+
+class TaskScheduler {
+public:
+	typedef std::size_t TaskId;
+
+	explicit TaskScheduler(unsigned int workers);
+	~TaskScheduler(); // waits for the submitted tasks
+
+	// may be called from any thread, including from inside a task; ids are valid until wait() returns
+	TaskId submit(const std::function<void()> &f,
+		const std::vector<TaskId> &dependencies = std::vector<TaskId>(), bool pinned = false);
+
+	// until every submitted task is done, rethrows the first exception of a task; the tasks that
+	// depend on a failed task, and any task started after the failure, are skipped
+	void wait();
+
+	unsigned int workers() const { return unsigned(queues_.size()); }
+	std::vector<TaskWorkerStats> stats() const;
+
+private:
+	struct Task {
+		std::function<void()> f;
+		std::size_t pending; // dependencies not done yet
+		std::vector<TaskId> dependents;
+		bool pinned;
+		bool done;
+	};
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<TaskId> tasks;
+		std::size_t executed;
+		std::size_t stolen;
+		double busySeconds;
+	};
+
+	TaskScheduler(const TaskScheduler &);
+	TaskScheduler &operator=(const TaskScheduler &);
+	void ready(TaskId id, bool pinned, unsigned int worker);
+	bool take(unsigned int worker, TaskId &id, bool &stolen);
+	void work(unsigned int worker);
+	void finish(TaskId id, unsigned int worker);
+
+	std::deque<Task> tasks_; // deque, so references stay valid as it grows
+	std::mutex graphMutex_; // tasks_, pending counts, dependents
+	std::vector<WorkerQueue *> queues_;
+	std::mutex pinnedMutex_;
+	std::deque<TaskId> pinned_; // only worker 0 takes from it
+	std::vector<std::thread> threads_;
+
+	std::mutex sleepMutex_;
+	std::condition_variable wake_; // a task became ready or the scheduler stops
+	std::condition_variable idle_; // every submitted task is done
+	std::atomic<std::size_t> readyCount_; // in the worker deques
+	std::atomic<std::size_t> pinnedCount_;
+	std::size_t submitted_;
+	std::size_t finished_;
+	std::atomic<unsigned int> nextQueue_; // round robin for tasks submitted from outside the workers
+	std::atomic<bool> failed_;
+	std::exception_ptr error_;
+	bool stop_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+#endif /*!_TASKSCHEDULER_HPP_*/
@@ -0,0 +1,74 @@
+#include "GoldenCompare.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+CsvCells readCsvCells(const string &filename) {
+	CsvCells cells;
+	ifstream iFile(filename.c_str());
+	string line;
+	while (getline(iFile, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') // files written on Windows
+			line.erase(line.size() - 1);
+		vector<string> row;
+		stringstream ss(line);
+		string cell;
+		while (getline(ss, cell, ','))
+			row.push_back(cell);
+		if (!line.empty() && line[line.size() - 1] == ',')
+			row.push_back("");
+		cells.push_back(row);
+	}
+	return cells;
+}
+
+// the whole cell is a number, "20080701" included
+static bool parseNumber(const string &s, double &value) {
+	if (s.empty())
+		return false;
+	char *end = 0;
+	value = strtod(s.c_str(), &end);
+	return *end == '\0';
+}
+
+GoldenComparison compareWithGolden(const string &outputFile, const string &goldenFile,
+	double absTolerance, double relTolerance) {
+	CsvCells golden = readCsvCells(goldenFile);
+	CsvCells output = readCsvCells(outputFile);
+	GoldenComparison result = { !output.empty(), golden.size(), 0, 0.0, "" };
+	if (!result.found)
+		return result;
+
+	for (size_t i = 0; i < golden.size(); i++) {
+		for (size_t j = 0; j < golden[i].size(); j++) {
+			stringstream where;
+			where << "row " << i + 1 << " column " << j + 1 << ": ";
+			if (i >= output.size() || j >= output[i].size()) {
+				if (result.mismatches++ == 0)
+					result.firstMismatch = where.str() + "missing, expected " + golden[i][j];
+				continue;
+			}
+			double a, b;
+			bool match;
+			if (parseNumber(golden[i][j], a) && parseNumber(output[i][j], b)) {
+				double diff = std::fabs(b - a);
+				result.maxAbsDiff = std::max(result.maxAbsDiff, diff);
+				match = diff <= absTolerance + relTolerance * std::fabs(a);
+			}
+			else
+				match = golden[i][j] == output[i][j];
+			if (!match && result.mismatches++ == 0)
+				result.firstMismatch = where.str() + output[i][j] + " expected " + golden[i][j];
+		}
+	}
+	if (output.size() > golden.size() && result.mismatches++ == 0) {
+		stringstream where;
+		where << output.size() - golden.size() << " rows more than the golden file";
+		result.firstMismatch = where.str();
+	}
+	return result;
+}
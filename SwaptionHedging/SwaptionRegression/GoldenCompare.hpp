@@ -0,0 +1,28 @@
+#ifndef     _GOLDENCOMPARE_HPP_
+# define    _GOLDENCOMPARE_HPP_
+
+#include <string>
+#include <vector>
+
+// This file and GoldenCompare.cpp compare a CSV output of one of the programs with its golden file,
+// numbers within a tolerance and everything else exactly. //
+
+typedef std::vector<std::vector<std::string> > CsvCells;
+
+// every line split at commas, the header line is kept as the first row
+CsvCells readCsvCells(const std::string &filename);
+
+struct GoldenComparison {
+	bool found; // the output file could be read
+	std::size_t rows; // of the golden file
+	std::size_t mismatches; // cells out of tolerance, missing rows and columns
+	double maxAbsDiff; // over the numeric cells
+	std::string firstMismatch; // like "row 12 column 3: 42.17 expected 42.1707", no commas
+};
+
+// the output may have more columns than the golden file, so columns added to a program later do not
+// break old golden files; a number b matches the golden a if |b - a| <= absTolerance + relTolerance * |a|
+GoldenComparison compareWithGolden(const std::string &outputFile, const std::string &goldenFile,
+	double absTolerance, double relTolerance);
+
+#endif /*!_GOLDENCOMPARE_HPP_*/
@@ -0,0 +1,173 @@
+#include "GoldenCompare.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Runs every program and mode of the manifest on the shipped market data, compares what they wrote with
+// the golden files and their run time with baseline.csv. The manifest (regression.csv) has one row per run:
+// Name,Directory,Command,Output,Golden,Abs Tolerance,Rel Tolerance,Max Slowdown
+// the command runs in the directory, the output is relative to it and the golden file to this directory.
+// Lines starting with # are skipped, commands cannot contain commas.
+
+struct RegressionCase {
+	string name;
+	string directory;
+	string command;
+	string output;
+	string golden;
+	double absTolerance;
+	double relTolerance;
+	double maxSlowdown; // fails when the run takes longer than the baseline times this
+};
+
+vector<RegressionCase> readManifest(const string &filename) {
+	CsvCells cells = readCsvCells(filename);
+	vector<RegressionCase> cases;
+	for (size_t i = 1; i < cells.size(); i++) { // after the header
+		const vector<string> &row = cells[i];
+		if (row.empty() || row[0].empty() || row[0][0] == '#')
+			continue;
+		if (row.size() < 8) {
+			cerr << filename << ": line " << i + 1 << " has " << row.size() << " columns, 8 expected" << endl;
+			continue;
+		}
+		RegressionCase c = { row[0], row[1], row[2], row[3], row[4], stod(row[5]), stod(row[6]), stod(row[7]) };
+		cases.push_back(c);
+	}
+	return cases;
+}
+
+// Name,Milliseconds
+map<string, double> readBaseline(const string &filename) {
+	CsvCells cells = readCsvCells(filename);
+	map<string, double> baseline;
+	for (size_t i = 1; i < cells.size(); i++)
+		if (cells[i].size() >= 2)
+			baseline[cells[i][0]] = stod(cells[i][1]);
+	return baseline;
+}
+
+bool copyFile(const string &from, const string &to) {
+	ifstream iFile(from.c_str(), ios::in | ios::binary);
+	if (!iFile)
+		return false;
+	ofstream oFile;
+	oFile.open(to.c_str(), ios::out | ios::trunc | ios::binary);
+	oFile << iFile.rdbuf();
+	return bool(oFile);
+}
+
+// usage: SwaptionRegression [manifest.csv] [runs] [--update | --baseline]
+// the time of a case is the best of its runs; --update records the outputs as the new golden files and
+// the times as the new baseline, after a change that is meant to move the numbers or the speed; --baseline
+// only records the times of the cases that match their golden files, e.g. on a new machine. A case without
+// a golden file fails, one without a baseline passes as not timed
+int main(int argc, char *argv[]) {
+	vector<string> args;
+	bool update = false, recordBaseline = false;
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--update")
+			update = true;
+		else if (string(argv[i]) == "--baseline")
+			recordBaseline = true;
+		else
+			args.push_back(argv[i]);
+	}
+	string manifestFile = (args.size() > 0) ? args[0] : "regression.csv";
+	int runs = (args.size() > 1) ? stoi(args[1]) : 1;
+	string baselineFile = "baseline.csv";
+
+	vector<RegressionCase> cases = readManifest(manifestFile);
+	map<string, double> baseline = readBaseline(baselineFile);
+	size_t failures = 0;
+
+	ofstream rFile;
+	rFile.open("regression_report.csv", ios::out | ios::trunc);
+	rFile << "Name" << "," << "Result" << "," << "Rows" << "," << "Mismatches" << "," << "Max Abs Diff" << ","
+		<< "First Mismatch" << "," << "Time (ms)" << "," << "Baseline (ms)" << "," << "Slowdown" << endl;
+
+	for (size_t k = 0; k < cases.size(); k++) {
+		const RegressionCase &c = cases[k];
+		cout << c.name << ": " << c.command << endl;
+		string shellCommand = "cd \"" + c.directory + "\" && " + c.command;
+		string outputFile = c.directory + "/" + c.output;
+
+		double millis = 0.0;
+		int status = 0;
+		for (int r = 0; r < runs && status == 0; r++) {
+			remove(outputFile.c_str()); // an old output must not pass for a new one
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			status = system(shellCommand.c_str());
+			double t = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			millis = (r == 0) ? t : std::min(millis, t);
+		}
+
+		string result = "ok";
+		GoldenComparison comparison = { false, 0, 0, 0.0, "" };
+		double slowdown = 0.0;
+		bool hasBaseline = baseline.count(c.name) > 0;
+		if (status != 0)
+			result = "command failed";
+		else if (update) {
+			result = copyFile(outputFile, c.golden) ? "updated" : "no output";
+			if (result == "updated")
+				baseline[c.name] = millis;
+		}
+		else {
+			if (!ifstream(c.golden.c_str()))
+				result = "no golden"; // nothing to check the output against, record it with --update
+			else {
+				comparison = compareWithGolden(outputFile, c.golden, c.absTolerance, c.relTolerance);
+				if (!comparison.found)
+					result = "no output";
+				else if (comparison.mismatches > 0)
+					result = "drift";
+			}
+			if (recordBaseline && result == "ok") {
+				baseline[c.name] = millis;
+				result = "baseline recorded";
+			}
+			else if (hasBaseline && baseline[c.name] > 0.0) {
+				slowdown = millis / baseline[c.name];
+				if (slowdown > c.maxSlowdown && result == "ok")
+					result = "slower";
+			}
+			else if (result == "ok")
+				result = "not timed"; // the results match, the speed is not checked until --baseline records it
+		}
+		if (result != "ok" && result != "updated" && result != "baseline recorded" && result != "not timed")
+			failures++;
+
+		cout << c.name << ": " << result << ", " << millis << " ms";
+		if (slowdown > 0.0)
+			cout << " (" << slowdown << "x baseline)";
+		if (comparison.mismatches > 0)
+			cout << ", " << comparison.mismatches << " mismatches, " << comparison.firstMismatch;
+		cout << endl << endl;
+		rFile << c.name << "," << result << "," << comparison.rows << "," << comparison.mismatches << ","
+			<< comparison.maxAbsDiff << "," << comparison.firstMismatch << "," << millis << ","
+			<< (hasBaseline ? baseline[c.name] : 0.0) << "," << slowdown << endl;
+	}
+	rFile.close();
+
+	if (update || recordBaseline) {
+		ofstream bFile;
+		bFile.open(baselineFile.c_str(), ios::out | ios::trunc);
+		bFile << "Name" << "," << "Milliseconds" << endl;
+		for (map<string, double>::const_iterator i = baseline.begin(); i != baseline.end(); ++i)
+			bFile << i->first << "," << i->second << endl;
+		bFile.close();
+	}
+
+	cout << cases.size() - failures << " of " << cases.size() << " cases passed" << endl;
+	return failures == 0 ? 0 : 1;
+}
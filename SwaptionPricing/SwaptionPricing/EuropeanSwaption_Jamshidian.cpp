@@ -31,8 +31,10 @@ yield curve it built, then price those swaption with the model.
 #include <string>
 #include <iostream>
 #include <streambuf> 
-#include <boost/timer.hpp>
 #include <iomanip>
+#include "../../SwaptionHedging/SwaptionHedging/StageTimer.hpp"
+#include "../../SwaptionHedging/SwaptionHedging/CountingEngine.hpp"
+#include "../../SwaptionHedging/SwaptionHedging/Arena.hpp"
 
 using namespace QuantLib;
 using namespace std;
@@ -72,8 +74,18 @@ void calibrateModel(
 	std::vector<boost::shared_ptr<CalibrationHelper> >& helpers) {
 
 	LevenbergMarquardt om;
-	model->calibrate(helpers, om,
-		EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+	NotificationCounter evaluations; // the model notifies once per set of trial parameters
+	evaluations.registerWith(model);
+	{
+		ScopedStage stage("calibration");
+		model->calibrate(helpers, om,
+			EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+		stage.arg("function evaluations", Real(evaluations.count()));
+		stage.arg("end criteria", Real(model->endCriteria()));
+	}
+	COUNT("calibrations", 1);
+	COUNT("calibration evaluations", evaluations.count());
+	ScopedStage reportStage("calibration report");
 
 	oFile.open("Calibration.csv", ios::out | ios::trunc);
 	oFile << "Swaption" << "," << "Relative Difference of IV" << "," << "Relative Difference of Price" << endl;
@@ -100,6 +112,7 @@ int main(int, char*[]) {
 	Date todaysDate(01, July, 2008);
 	Calendar calendar = TARGET();
 	Settings::instance().evaluationDate() = todaysDate;
+	StageTimer::instance().enable();
 
 	std::vector <Date > dates; // Dates of each discount factor point
 	std::vector < DiscountFactor > dfs; // Discount Factor
@@ -137,9 +150,13 @@ int main(int, char*[]) {
 	dfs.push_back(0.273871); dfs.push_back(0.180376);
 
 	// build yield curve
-	Handle<YieldTermStructure> rhTermStructure(
-		boost::shared_ptr<InterpolatedDiscountCurve<Linear> >(
-			new InterpolatedDiscountCurve <Linear>(dates, dfs, dc, cal)));
+	Handle<YieldTermStructure> rhTermStructure;
+	{
+		ScopedStage stage("curve");
+		rhTermStructure = Handle<YieldTermStructure>(
+			boost::shared_ptr<InterpolatedDiscountCurve<Linear> >(
+				new InterpolatedDiscountCurve <Linear>(dates, dfs, dc, cal)));
+	}
 
 	// Define properties of swap/swaption
 	Frequency fixedLegFrequency = Semiannual;
@@ -178,13 +195,14 @@ int main(int, char*[]) {
 	// defining the models
 	boost::shared_ptr<HullWhite> modelHW(new HullWhite(rhTermStructure));
 	for (i = 0; i < swaptions.size(); i++) {
-		swaptions[i]->setPricingEngine(boost::shared_ptr<PricingEngine>(
-			new JamshidianSwaptionEngine(modelHW)));
+		swaptions[i]->setPricingEngine(countingEngine(
+			boost::shared_ptr<PricingEngine>(new JamshidianSwaptionEngine(modelHW)), "calibration engine calculations"));
 	}
 
 	// calibrate based on all of swaptions in order to find the errors
 	calibrateModel(modelHW, swaptions);
 
+	CounterRegistry::instance().snapshot("calibration");
 	std::cout << "calibrated to:\n"
 		<< "a = " << modelHW->params()[0] << ", "
 		<< "sigma = " << modelHW->params()[1]
@@ -192,8 +210,11 @@ int main(int, char*[]) {
 
 	////////////////// Swaption Pricing /////////////////////////
 	oFile.open("result.csv", ios::out | ios::trunc);
+	Arena arena;
 	for (int i = 1; i <= 10; i++) { // i for maturity
 		for (int j = 1; j <= 10; j++) { // j for tenor
+			ScopedStage stage("pricing", to_string(i) + "x" + to_string(j));
+			ArenaScope scope(arena, true); // everything the swaption allocates goes in one release
 			Date startDate = calendar.advance(settlement, i, Years,
 				floatingLegConvention);
 			Date maturity = calendar.advance(startDate, j, Years,
@@ -211,8 +232,8 @@ int main(int, char*[]) {
 				fixedSchedule, dummyFixedRate, fixedLegDayCounter,
 				floatSchedule, indexSixMonths, 0.0,
 				indexSixMonths->dayCounter())); // used for calculating fixedATMRate
-			swap->setPricingEngine(boost::shared_ptr<PricingEngine>(
-				new DiscountingSwapEngine(rhTermStructure))); // swap pricing
+			swap->setPricingEngine(countingEngine(
+				boost::shared_ptr<PricingEngine>(new DiscountingSwapEngine(rhTermStructure)), "swap engine calculations")); // swap pricing
 			Rate fixedATMRate = swap->fairRate();
 
 			// define the underying swap of the swaption we want to price
@@ -228,15 +249,29 @@ int main(int, char*[]) {
 			Swaption atmEuropeanSwaption(atmSwap, europeanExercise);
 
 			// perform pricing
-			atmEuropeanSwaption.setPricingEngine(boost::shared_ptr<PricingEngine>(
-				new JamshidianSwaptionEngine(modelHW)));
-			oFile << i << "x" << j << "," << atmEuropeanSwaption.NPV() << ","
-				<< atmEuropeanSwaption.impliedVolatility(atmEuropeanSwaption.NPV(), rhTermStructure, 0.05) << endl;
+			atmEuropeanSwaption.setPricingEngine(countingEngine(
+				boost::shared_ptr<PricingEngine>(new JamshidianSwaptionEngine(modelHW)), "swaption engine calculations"));
+			Real npv = atmEuropeanSwaption.NPV();
+			Volatility implied;
+			{
+				ScopedStage ivStage("implied vol");
+				COUNT("implied vol solves", 1);
+				implied = atmEuropeanSwaption.impliedVolatility(npv, rhTermStructure, 0.05);
+			}
+			oFile << i << "x" << j << "," << npv << "," << implied << endl;
 			//std::cout << /*"HW (Jamshidian) :      " << */atmEuropeanSwaption.NPV() << std::endl;
 			//cout << /*"implied volatility:      " << */atmEuropeanSwaption.impliedVolatility(atmEuropeanSwaption.NPV(), rhTermStructure, 0.05) << endl;
 		}
 	}
 	oFile.close();
+	StageTimer::instance().write("stages.csv", "trace.json");
+	COUNT("arena allocations", arena.totalAllocations());
+	COUNT("arena allocations alive at release", arena.keptAlive());
+	CounterRegistry::instance().snapshot("pricing");
+	ofstream cFile;
+	cFile.open("counters.csv", ios::out | ios::trunc);
+	CounterRegistry::instance().write(cFile);
+	cFile.close();
 	return 0;
 }
 
@@ -31,12 +31,10 @@ price swaptions based on the forward swap rate.
 #include <string>
 #include <iostream>
 #include <streambuf> 
-#include <boost/timer.hpp>
-#include <iomanip>
-
-#include <boost/timer.hpp>
-#include <iostream>
 #include <iomanip>
+#include "../../SwaptionHedging/SwaptionHedging/StageTimer.hpp"
+#include "../../SwaptionHedging/SwaptionHedging/CountingEngine.hpp"
+#include "../../SwaptionHedging/SwaptionHedging/Arena.hpp"
 
 using namespace QuantLib;
 using namespace std;
@@ -77,8 +75,18 @@ void calibrateModel(
 
 	// perform calibration
 	LevenbergMarquardt om;
-	model->calibrate(helpers, om,
-		EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+	NotificationCounter evaluations; // the model notifies once per set of trial parameters
+	evaluations.registerWith(model);
+	{
+		ScopedStage stage("calibration");
+		model->calibrate(helpers, om,
+			EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+		stage.arg("function evaluations", Real(evaluations.count()));
+		stage.arg("end criteria", Real(model->endCriteria()));
+	}
+	COUNT("calibrations", 1);
+	COUNT("calibration evaluations", evaluations.count());
+	ScopedStage reportStage("calibration report");
 
 	// export the market value, implied volatility of swaption used in calibration
 	oFile.open("Real_Swaption.csv", ios::out | ios::trunc);
@@ -115,8 +123,18 @@ void calibrateModel2(
 	// use to calibrate partly of the swaption volatility surface instead of the whole
 
 	LevenbergMarquardt om;
-	model->calibrate(helpers, om,
-		EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+	NotificationCounter evaluations; // the model notifies once per set of trial parameters
+	evaluations.registerWith(model);
+	{
+		ScopedStage stage("calibration");
+		model->calibrate(helpers, om,
+			EndCriteria(400, 100, 1.0e-8, 1.0e-8, 1.0e-8));
+		stage.arg("function evaluations", Real(evaluations.count()));
+		stage.arg("end criteria", Real(model->endCriteria()));
+	}
+	COUNT("calibrations", 1);
+	COUNT("calibration evaluations", evaluations.count());
+	ScopedStage reportStage("calibration report");
 
 	//oFile.open("Calibration2.csv", ios::out | ios::trunc);
 	for (Size k = 0; k < helpers.size(); k++) {
@@ -130,10 +148,13 @@ void calibrateModel2(
 	//oFile.close();
 }
 
-int main(int, char*[]) {
+// SwaptionPricingMC [seed]: every swaption simulates from seed if given, from a new random seed otherwise
+int main(int argc, char* argv[]) {
+	BigInteger fixedSeed = (argc > 1) ? stoi(argv[1]) : 0;
 	Date todaysDate(01, July, 2008);
 	Calendar calendar = TARGET();
 	Settings::instance().evaluationDate() = todaysDate;
+	StageTimer::instance().enable();
 
 	std::vector <Date > dates; // Dates of each discount factor point
 	std::vector < DiscountFactor > dfs; // Discount Factor
@@ -171,9 +192,13 @@ int main(int, char*[]) {
 	dfs.push_back(0.273871); dfs.push_back(0.180376);
 
 	// build yield curve
-	Handle<YieldTermStructure> rhTermStructure(
-		boost::shared_ptr<InterpolatedDiscountCurve<Linear> >(
-			new InterpolatedDiscountCurve <Linear>(dates, dfs, dc, cal)));
+	Handle<YieldTermStructure> rhTermStructure;
+	{
+		ScopedStage stage("curve");
+		rhTermStructure = Handle<YieldTermStructure>(
+			boost::shared_ptr<InterpolatedDiscountCurve<Linear> >(
+				new InterpolatedDiscountCurve <Linear>(dates, dfs, dc, cal)));
+	}
 
 	// Define properties of swap/swaption
 	Frequency fixedLegFrequency = Annual;
@@ -214,13 +239,14 @@ int main(int, char*[]) {
 
 	std::cout << "Hull-White (analytic formulae) calibration" << std::endl;
 	for (i = 0; i < swaptions.size(); i++) {
-		swaptions[i]->setPricingEngine(boost::shared_ptr<PricingEngine>(
-			new JamshidianSwaptionEngine(modelHW)));
+		swaptions[i]->setPricingEngine(countingEngine(
+			boost::shared_ptr<PricingEngine>(new JamshidianSwaptionEngine(modelHW)), "calibration engine calculations"));
 	}
 
 
 	calibrateModel(modelHW, swaptions);
 	calibrateModel2(modelHW, swaptions);
+	CounterRegistry::instance().snapshot("calibration");
 	std::cout << "calibrated to:\n"
 		<< "a = " << modelHW->params()[0] << ", "
 		<< "sigma = " << modelHW->params()[1]
@@ -229,8 +255,11 @@ int main(int, char*[]) {
 	//////////////// SWaption Pricing by Monte Carlo //////////////////
 	oFile.open("MC_Swaption.csv", ios::out | ios::trunc);
 	oFile << "Swaption Type" << ","  << "MC IV" << "," << "MC Price" << endl;
+	Arena arena;
 	for (int Maturity = 1; Maturity <= 10; Maturity++) {
 		for (int Tenor = 1; Tenor <= 10; Tenor++) {
+			ScopedStage stage("pricing", to_string(Maturity) + "x" + to_string(Tenor));
+			ArenaScope scope(arena, true); // everything the swaption allocates goes in one release
 			int Length = Maturity + Tenor;
 			Date startDate = calendar.advance(settlement, Maturity, Years,
 				floatingLegConvention);
@@ -249,8 +278,8 @@ int main(int, char*[]) {
 				fixedSchedule, dummyFixedRate, fixedLegDayCounter,
 				floatSchedule, indexThreeMonths, 0.0,
 				indexThreeMonths->dayCounter())); // used for calculating fixedATMRate
-			swap->setPricingEngine(boost::shared_ptr<PricingEngine>(
-				new DiscountingSwapEngine(rhTermStructure))); // swap pricing
+			swap->setPricingEngine(countingEngine(
+				boost::shared_ptr<PricingEngine>(new DiscountingSwapEngine(rhTermStructure)), "swap engine calculations")); // swap pricing
 
 			// get ATM strike rate
 			Rate fixedATMRate = swap->fairRate();
@@ -270,8 +299,8 @@ int main(int, char*[]) {
 
 			// define the swaption we want to price
 			Swaption atmEuropeanSwaption(atmSwap, europeanExercise);
-			atmEuropeanSwaption.setPricingEngine(boost::shared_ptr<PricingEngine>(
-				new JamshidianSwaptionEngine(modelHW)));
+			atmEuropeanSwaption.setPricingEngine(countingEngine(
+				boost::shared_ptr<PricingEngine>(new JamshidianSwaptionEngine(modelHW)), "swaption engine calculations"));
 			std::cout << "HW (Jamshidian) :      " << atmEuropeanSwaption.NPV() << std::endl;
 			cout << "implied volatility:      " << io::volatility(atmEuropeanSwaption.impliedVolatility(atmEuropeanSwaption.NPV(), rhTermStructure, 0.05)) << endl;
 
@@ -279,7 +308,7 @@ int main(int, char*[]) {
 			Real x;
 			Real a = modelHW->params()[0];
 			Real sigma = modelHW->params()[1];
-			BigInteger seed = SeedGenerator::instance().get(); // seed for generating random number
+			BigInteger seed = fixedSeed != 0 ? fixedSeed : SeedGenerator::instance().get(); // seed for generating random number
 			MersenneTwisterUniformRng unifMt(seed);
 			BoxMullerGaussianRng < MersenneTwisterUniformRng > bmGauss(unifMt);
 			boost::shared_ptr < HullWhiteProcess > shortRateProces(
@@ -288,18 +317,27 @@ int main(int, char*[]) {
 			Real dw, temp = 0;
 			Size numVals = 1e4; // simulation times
 			Rate swapRate = 0, swaptionNPV = 0;
-			for (Size j = 1; j <= numVals; ++j) {
-				dw = bmGauss.next().value;
-				x = shortRateProces->evolve(t, x0, dt, dw);
-				for (Size i = (dt + 1); i <= Length; i++) {
-					temp += modelHW->discountBond(dt, i, x);
+			{
+				ScopedStage mcStage("monte carlo");
+				mcStage.arg("paths", Real(numVals));
+				for (Size j = 1; j <= numVals; ++j) {
+					dw = bmGauss.next().value;
+					x = shortRateProces->evolve(t, x0, dt, dw);
+					for (Size i = (dt + 1); i <= Length; i++) {
+						temp += modelHW->discountBond(dt, i, x);
+					}
+					swapRate = (1.0 - modelHW->discountBond(dt, Length, x)) / temp;
+					swaptionNPV += rhTermStructure->discount(settlement + Maturity * Years)*max((swapRate - fixedATMRate), 0.0)*temp;
+					temp = 0;
 				}
-				swapRate = (1.0 - modelHW->discountBond(dt, Length, x)) / temp;
-				swaptionNPV += rhTermStructure->discount(settlement + Maturity * Years)*max((swapRate - fixedATMRate), 0.0)*temp;
-				temp = 0;
 			}
 			swaptionNPV /= numVals;
-			Real swaptionIV = atmEuropeanSwaption.impliedVolatility(swaptionNPV, rhTermStructure, 0.05);
+			Real swaptionIV;
+			{
+				ScopedStage ivStage("implied vol");
+				COUNT("implied vol solves", 1);
+				swaptionIV = atmEuropeanSwaption.impliedVolatility(swaptionNPV, rhTermStructure, 0.05);
+			}
 			//cout << i << "x" << j << endl;
 			//cout << "Swaption NPV =" << swaptionNPV << endl;
 			//cout << "Swaption IV  =" << swaptionIV << endl;
@@ -308,6 +346,14 @@ int main(int, char*[]) {
 	}
 
 	oFile.close();
+	StageTimer::instance().write("stages.csv", "trace.json");
+	COUNT("arena allocations", arena.totalAllocations());
+	COUNT("arena allocations alive at release", arena.keptAlive());
+	CounterRegistry::instance().snapshot("pricing");
+	ofstream cFile;
+	cFile.open("counters.csv", ios::out | ios::trunc);
+	CounterRegistry::instance().write(cFile);
+	cFile.close();
 	return 0;
 
 }